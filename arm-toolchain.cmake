@@ -12,7 +12,9 @@ set(CMAKE_AR ${CROSS_COMPILE}ar)
 set(CMAKE_RANLIB ${CROSS_COMPILE}ranlib)
 
 # ARM特定的编译选项
-set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -march=armv7-a -mfpu=neon")
+# 浮点 ABI 必须显式给出且与板上的库一致（软浮点 ABI 下不能用 NEON），硬浮点工具链用 -DARM_FLOAT_ABI=hard
+set(ARM_FLOAT_ABI softfp CACHE STRING "ARM float ABI: softfp or hard")
+set(CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -march=armv7-a -mfpu=neon -mfloat-abi=${ARM_FLOAT_ABI}")
 
 # 设置查找根路径
 set(CMAKE_FIND_ROOT_PATH /home/xjs/project/lab/arm-ncurses/install)
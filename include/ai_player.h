@@ -1,15 +1,45 @@
 #pragma once
+#include "mate_search.h"
+#include "opening_book.h"
+#include "search.h"
 
 typedef struct {
     int sy, sx, dy, dx;
     int score;
 } Move;
 
+// 难度只用节点数、深度上限和评估扰动来限制，不依赖墙钟时间，
+// 单线程搜索在不同机器上走法完全相同
+typedef struct {
+    const char* name;
+    int depth;          // 0 表示不限
+    uint64_t nodes;
+    int eval_noise;
+} Difficulty;
+
+#define DIFFICULTY_COUNT 4
+#define DIFFICULTY_DEFAULT 2
+extern const Difficulty difficulty_levels[DIFFICULTY_COUNT];
+
 class AIPlayer {
 public:
-    AIPlayer() {}
+    AIPlayer();
     ~AIPlayer() {}
     int make_move();
+    void set_book(const OpeningBook* opening_book) { book = opening_book; }
+    void set_limits(const SearchLimits& search_limits) { limits = search_limits; }
+    void set_clock(int remaining_ms, int increment_ms);
+    void set_difficulty(int level);
+    const SearchStats& last_stats() const { return engine.last_stats(); }
+    bool last_move_from_book() const { return used_book; }
+    // 在当前棋盘上为 side 一方求强制将杀，不走棋
+    MateResult find_mate(int side, const MateLimits& mate_limits);
 private:
+    bool book_move(Move& move);
     int execute_move(Move& move);
+    const OpeningBook* book;
+    bool used_book;
+    Engine engine;
+    SearchLimits limits;
+    MateSolver mate_solver;
 };
\ No newline at end of file
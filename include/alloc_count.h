@@ -0,0 +1,6 @@
+#pragma once
+#include <cstdint>
+
+// 堆分配计数：CHESS_ALLOC_COUNT 构建（Debug 构建默认打开）替换全局 operator new，
+// 按线程统计启动以来的分配次数，用来确认搜索过程中没有申请内存。其他构建中始终为 0
+uint64_t alloc_count();
@@ -0,0 +1,6 @@
+#pragma once
+
+// 在固定局面集合上以固定深度搜索，打印总节点数（行为签名）、用时和 NPS。
+// 每个局面都从清空的置换表开始单线程搜索，多线程时只是把局面分给不同线程，
+// 因此无论线程数多少，节点数签名都相同。返回 0 表示成功
+int run_search_bench(int depth, int threads, int hash_mb);
@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+
+// 位棋盘：第 sq 位对应 board[sq / 8][sq % 8]，sq = y * 8 + x
+typedef uint64_t Bitboard;
+
+#define SQ(y, x)   ((y) * 8 + (x))
+#define SQ_Y(sq)   ((sq) >> 3)
+#define SQ_X(sq)   ((sq) & 7)
+#define BIT(sq)    (1ULL << (sq))
+
+inline int popcount(Bitboard b) {
+    return __builtin_popcountll(b);
+}
+
+inline int lsb(Bitboard b) {
+    return __builtin_ctzll(b);
+}
+
+inline int msb(Bitboard b) {
+    return 63 - __builtin_clzll(b);
+}
+
+inline int pop_lsb(Bitboard& b) {
+    int sq = __builtin_ctzll(b);
+    b &= b - 1;
+    return sq;
+}
+
+// 8 个方向，前 4 个为斜线，后 4 个为直线；下标为偶数的方向 sq 递减
+constexpr int direction_dy[8] = {-1, 1, -1, 1, -1, 1,  0, 0};
+constexpr int direction_dx[8] = {-1, 1,  1, -1, 0, 0, -1, 1};
+
+constexpr int knight_dy[8] = {-2, -2, -1, -1,  1,  1,  2,  2};
+constexpr int knight_dx[8] = {-1,  1, -2,  2, -2,  2, -1,  1};
+
+constexpr bool on_board(int y, int x) {
+    return y >= 0 && y < 8 && x >= 0 && x < 8;
+}
+
+// 编译期生成的攻击表，[color] 中 0 为白方、1 为黑方
+struct AttackTables {
+    Bitboard knight[64];
+    Bitboard king[64];
+    Bitboard pawn[2][64];
+    Bitboard rays[8][64];         // 从某格沿一个方向到棋盘边缘（不含起点）
+    Bitboard between[64][64];     // 同一直线或斜线上两格之间（不含两端），不共线时为 0
+};
+
+constexpr AttackTables make_attack_tables() {
+    AttackTables t = {};
+    for (int sq = 0; sq < 64; sq++) {
+        int y = SQ_Y(sq), x = SQ_X(sq);
+        for (int i = 0; i < 8; i++) {
+            if (on_board(y + knight_dy[i], x + knight_dx[i])) {
+                t.knight[sq] |= BIT(SQ(y + knight_dy[i], x + knight_dx[i]));
+            }
+            if (on_board(y + direction_dy[i], x + direction_dx[i])) {
+                t.king[sq] |= BIT(SQ(y + direction_dy[i], x + direction_dx[i]));
+            }
+        }
+
+        // 白兵向上（y 减小）进攻，黑兵向下
+        for (int dx = -1; dx <= 1; dx += 2) {
+            if (on_board(y - 1, x + dx)) t.pawn[0][sq] |= BIT(SQ(y - 1, x + dx));
+            if (on_board(y + 1, x + dx)) t.pawn[1][sq] |= BIT(SQ(y + 1, x + dx));
+        }
+
+        // 沿 8 个方向走，记录射线和经过的格子
+        for (int d = 0; d < 8; d++) {
+            Bitboard path = 0;
+            int ny = y + direction_dy[d], nx = x + direction_dx[d];
+            while (on_board(ny, nx)) {
+                t.between[sq][SQ(ny, nx)] = path;
+                path |= BIT(SQ(ny, nx));
+                ny += direction_dy[d];
+                nx += direction_dx[d];
+            }
+            t.rays[d][sq] = path;
+        }
+    }
+    return t;
+}
+
+inline constexpr AttackTables attack_tables = make_attack_tables();
+
+inline constexpr const Bitboard (&knight_attacks)[64] = attack_tables.knight;
+inline constexpr const Bitboard (&king_attacks)[64] = attack_tables.king;
+inline constexpr const Bitboard (&pawn_attacks)[2][64] = attack_tables.pawn;
+inline constexpr const Bitboard (&between_masks)[64][64] = attack_tables.between;
+
+// 单个方向的滑动攻击：射线被挡住时去掉第一个阻挡格之后的部分
+template <int Dir>
+inline Bitboard ray_attacks(int sq, Bitboard occupied) {
+    Bitboard attacks = attack_tables.rays[Dir][sq];
+    Bitboard blockers = attacks & occupied;
+    if (blockers) {
+        int first = Dir % 2 == 0 ? msb(blockers) : lsb(blockers);
+        attacks ^= attack_tables.rays[Dir][first];
+    }
+    return attacks;
+}
+
+// 滑动棋子的攻击范围（遇到第一个棋子即停止，包含该格）
+inline Bitboard bishop_attacks(int sq, Bitboard occupied) {
+    return ray_attacks<0>(sq, occupied) | ray_attacks<1>(sq, occupied)
+         | ray_attacks<2>(sq, occupied) | ray_attacks<3>(sq, occupied);
+}
+
+inline Bitboard rook_attacks(int sq, Bitboard occupied) {
+    return ray_attacks<4>(sq, occupied) | ray_attacks<5>(sq, occupied)
+         | ray_attacks<6>(sq, occupied) | ray_attacks<7>(sq, occupied);
+}
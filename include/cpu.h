@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include "bitboard.h"
+
+// 热点内核（位计数与位扫描、滑动攻击、评估累加）按指令集各编译一份，
+// 启动时根据 CPUID / hwcaps 选出可用的最快版本，也可以在命令行用 --cpu 强制指定
+#define CPU_GENERIC 0   // 编译器默认指令集
+#define CPU_POPCNT  1   // x86-64：popcnt
+#define CPU_BMI2    2   // x86-64：popcnt + bmi2，滑动攻击改用 pext 查表
+#define CPU_AVX2    3   // x86-64：bmi2 + avx2，评估累加用 gather 一次处理 8 格
+#define CPU_NEON    4   // 32 位 ARM：neon，批量评估用 vtbl 查表
+#define CPU_VARIANT_COUNT 5
+
+#if defined(__x86_64__)
+#define CPU_TARGET_POPCNT __attribute__((target("popcnt")))
+#define CPU_TARGET_BMI2   __attribute__((target("popcnt,bmi,bmi2")))
+#define CPU_TARGET_AVX2   __attribute__((target("popcnt,bmi,bmi2,avx2")))
+#else
+#define CPU_TARGET_POPCNT
+#define CPU_TARGET_BMI2
+#define CPU_TARGET_AVX2
+#endif
+
+// NEON 内联函数要求 aarch64，或 32 位 ARM 的 softfp / hard 浮点 ABI；软浮点 ABI 下 __ARM_FP 未定义，
+// neon 版本不编译向量内核，运行时也不会被选中
+#if defined(__aarch64__) || (defined(__arm__) && defined(__ARM_FP))
+#define CPU_HAVE_NEON 1
+#else
+#define CPU_HAVE_NEON 0
+#endif
+
+#if defined(__arm__) && CPU_HAVE_NEON
+#define CPU_TARGET_NEON   __attribute__((target("fpu=neon")))
+#else
+#define CPU_TARGET_NEON
+#endif
+
+// 内核实现必须内联进各版本的入口函数，才会按入口的指令集生成代码
+#define CPU_KERNEL_INLINE inline __attribute__((always_inline))
+
+// 为模板 impl<Isa> 生成各指令集版本的入口函数，table 按 CPU_* 下标排列
+#define CPU_DISPATCH_TABLE(table, impl, ret, params, args)                                  \
+    ret table##_generic params { return impl<CPU_GENERIC> args; }                          \
+    CPU_TARGET_POPCNT static ret table##_popcnt params { return impl<CPU_POPCNT> args; }   \
+    CPU_TARGET_BMI2 static ret table##_bmi2 params { return impl<CPU_BMI2> args; }         \
+    CPU_TARGET_AVX2 static ret table##_avx2 params { return impl<CPU_AVX2> args; }         \
+    CPU_TARGET_NEON static ret table##_neon params { return impl<CPU_NEON> args; }         \
+    ret (*const table[CPU_VARIANT_COUNT]) params = {                                       \
+        table##_generic, table##_popcnt, table##_bmi2, table##_avx2, table##_neon          \
+    }
+
+extern const char* const cpu_variant_names[CPU_VARIANT_COUNT];
+
+bool cpu_supports(int variant);
+// 当前机器上最快的可用版本
+int cpu_detect();
+// 切换内核版本，name 为 "auto" 时重新检测；名字未知或本机不支持时返回 false
+bool cpu_select(const char* name);
+bool cpu_select(int variant);
+
+// pext 查表：每格一个相关占位掩码和在 pext_attacks 中的起始下标
+#define PEXT_TABLE_SIZE (5248 + 102400)
+
+typedef struct {
+    Bitboard mask[64];
+    uint32_t offset[64];
+} PextSlider;
+
+extern PextSlider pext_bishop;
+extern PextSlider pext_rook;
+extern Bitboard pext_attacks[PEXT_TABLE_SIZE];
+
+inline uint64_t pext(uint64_t b, uint64_t mask) {
+#if defined(__x86_64__)
+    // 直接写指令，调用方不需要带 bmi2 的 target 属性，只有 bmi2 版本会执行到这里
+    uint64_t r;
+    __asm__("pextq %2, %1, %0" : "=r"(r) : "r"(b), "r"(mask));
+    return r;
+#else
+    uint64_t r = 0;
+    for (uint64_t bit = 1; mask; bit <<= 1) {
+        if (b & mask & -mask) r |= bit;
+        mask &= mask - 1;
+    }
+    return r;
+#endif
+}
+
+template <int Isa>
+CPU_KERNEL_INLINE Bitboard slider_bishop_attacks(int sq, Bitboard occupied) {
+    if constexpr (Isa == CPU_BMI2 || Isa == CPU_AVX2) {
+        return pext_attacks[pext_bishop.offset[sq] + pext(occupied, pext_bishop.mask[sq])];
+    } else {
+        return bishop_attacks(sq, occupied);
+    }
+}
+
+template <int Isa>
+CPU_KERNEL_INLINE Bitboard slider_rook_attacks(int sq, Bitboard occupied) {
+    if constexpr (Isa == CPU_BMI2 || Isa == CPU_AVX2) {
+        return pext_attacks[pext_rook.offset[sq] + pext(occupied, pext_rook.mask[sq])];
+    } else {
+        return rook_attacks(sq, occupied);
+    }
+}
+
+class Position;
+typedef uint16_t MoveCode;
+
+// 当前选中的内核，默认指向通用版本，程序启动时自动切换到检测出的版本
+typedef struct {
+    int variant;
+    // pieces 中各棋子走到 allowed 范围内的伪合法走法
+    int (*generate_moves)(const Position& pos, Bitboard pieces, Bitboard allowed, MoveCode* list);
+    Bitboard (*attackers_to)(const Position& pos, int sq, int attacker_side, Bitboard occ);
+    // 子力与位置分，白方视角
+    int (*evaluate_pieces)(const Position& pos);
+    // 结构数组布局的 count 个局面的子力与位置分，squares[sq * stride + i]
+    void (*evaluate_batch)(const int8_t* squares, int stride, int count, int* scores);
+} CpuKernels;
+
+extern CpuKernels cpu_kernels;
+
+// 各模块按 CPU_* 下标导出的内核表
+extern int (*const movegen_kernels[CPU_VARIANT_COUNT])(const Position& pos, Bitboard pieces, Bitboard allowed, MoveCode* list);
+extern Bitboard (*const attackers_kernels[CPU_VARIANT_COUNT])(const Position& pos, int sq, int attacker_side, Bitboard occ);
+extern int (*const evaluate_kernels[CPU_VARIANT_COUNT])(const Position& pos);
+extern void (*const evaluate_batch_kernels[CPU_VARIANT_COUNT])(const int8_t* squares, int stride, int count, int* scores);
@@ -0,0 +1,15 @@
+#pragma once
+#include "position.h"
+
+// 专用评估给出的必胜分，远高于子力差但低于任何杀棋分
+#define SCORE_KNOWN_WIN 10000
+
+// 棋子不多时按子力组合分派的专用评估，轮到走棋的一方视角；没有对应的评估函数时返回 false
+bool evaluate_endgame(const Position& pos, int& score);
+
+// KXK 位库：王加一个后或车对单王，第一次查询时用逆向分析生成，每个局面 1 位。
+// 强方王对称到左上四分之一，共 2 × 16 × 64 × 64 位，每张表 16KB
+#define KXK_POSITIONS (2 * 16 * 64 * 64)
+
+// strong_to_move 为 true 时轮到强方走；返回强方能否取胜（无升变、无五十步规则）
+bool probe_kxk(int piece_type, int strong_king, int strong_piece, int weak_king, bool strong_to_move);
@@ -0,0 +1,49 @@
+#pragma once
+#include "position.h"
+#include "pawns.h"
+#include <cstdint>
+#include <vector>
+
+#define EVAL_CACHE_SIZE 32768   // 2 的幂
+
+// 子力（get_piece_value × 10）加位置分和兵形分，从轮到走棋的一方视角
+int evaluate(const Position& pos);
+
+// 结构数组布局的一批局面：同一格在各局面中的棋子连续存放（squares[sq * stride + i]），
+// 批量评估时用字节查表指令一次处理多个局面（AVX2 32 个，NEON 8 个）
+#define EVAL_BATCH_ALIGN 32     // 每格的存储长度取整到它的倍数
+
+class EvalBatch {
+public:
+    explicit EvalBatch(int capacity);
+    int size() const { return count; }
+    int capacity() const { return limit; }
+    void clear() { count = 0; }
+    // 追加一个局面，已满时返回 false
+    bool add(const Position& pos);
+    // 子力与位置分（白方视角），与单个局面的 evaluate 中这一部分相同；scores 至少 size() 个
+    void evaluate(int* scores) const;
+private:
+    int count;
+    int limit;
+    int stride;
+    std::vector<int8_t> squares;
+};
+
+// 单个棋子的位置分，表格定义在 piece_square.h
+int get_positional_score(int piece, int r, int c);
+
+typedef struct {
+    uint64_t key;
+    int score;
+} EvalCacheEntry;
+
+// 每个搜索线程一份：兵形表按 pawn_key 缓存兵形分，评估缓存按完整哈希缓存整个评估
+class Evaluator {
+public:
+    Evaluator();
+    int evaluate(const Position& pos);
+private:
+    PawnTable pawns;
+    EvalCacheEntry cache[EVAL_CACHE_SIZE];
+};
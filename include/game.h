@@ -1,29 +1,66 @@
 #pragma once
-#include <vector>
+#include <chrono>
+#include <string>
+#include "ai_player.h"
+#include "latency.h"
+#include "opening_book.h"
+#include "search_stats.h"
+#define HINT_LINES 3
+#define HINT_NODES 400000
+
 class Game {
 public:
     Game() : current_round(1), white_in_check(false), black_in_check(false)
-            , white_in_checkmate(false), black_in_checkmate(false), white_cap_count(0)
+            , white_in_checkmate(false), black_in_checkmate(false), stalemate(false)
+            , game_status(STATUS_NORMAL), white_cap_count(0)
             , black_cap_count(0) , selected_piece(0), selected_x(0), selected_y(0)
-            , predicted_moves(8, std::vector<int>(8, 0)), choose(false) {};
+            , predicted_moves(0), legal_round(0), choose(false)
+            , frame_valid(false), dashboard_round(0), search_stats(NULL), stats_prometheus(false)
+            , clock_enabled(false), clock_base_ms(0), clock_increment_ms(0), clock_round(0), time_forfeit(0)
+            , difficulty(DIFFICULTY_DEFAULT), hint_count(0), hint_moves(0)
+            , latency_overlay(false), input_us(0) {};
     ~Game() {};
     void double_mode_start();
     void single_mode_start();
     void restart();
+    bool load_book(const char* path);
+    void set_stats_output(const char* path, bool prometheus);
+    void set_time_control(int base_ms, int increment_ms);
+    void set_difficulty(int level) { difficulty = level; }
+    int get_difficulty() const { return difficulty; }
+    int calculate_score(int side);
+    // 把各阶段的延迟统计写入文件，退出时调用
+    bool dump_latency(const char* path) const { return latency.dump(path); }
+    void write_latency(FILE* out) const { latency.write(out); }
 
 private:
+    void render(int start_y, int start_x, int cur_y, int cur_x);
     void draw_ui(int start_y, int start_x, int cur_y, int cur_x);
     void draw_dashboard(int start_y, int start_x, int turn, int round);
-    int calculate_score(int side);
+    int draw_book(int start_y, int start_x, int turn);
+    int draw_search_stats(int start_y, int start_x);
+    void draw_clocks(int start_y, int start_x);
+    int draw_hints(int start_y, int start_x);
+    void show_hint();
+    int timed_getch();
+    void draw_latency(int start_y, int start_x, int max_rows);
+    void update_clocks();
+    int remaining_ms(int color) const;
     int selected_piece;
     int selected_x;
     int selected_y;
-    std::vector<std::vector<int>> predicted_moves;
+    void update_legal_moves();
+    Bitboard predicted_moves;     // 选中棋子可以走到的格子
+    Bitboard legal_targets[64];   // 当前回合每个起点格的合法目标格
+    int legal_round;
     int current_round;
     bool white_in_check;
     bool black_in_check;
     bool white_in_checkmate;
     bool black_in_checkmate;
+    bool stalemate;
+    int game_status;
+    StatusCache status_cache;
 
     int white_captured[16]; 
     int black_captured[16];
@@ -31,4 +68,38 @@ private:
     int black_cap_count;
 
     bool choose;
+
+    // 上一帧的绘制状态，用于差量重绘
+    int frame_cells[8][8];
+    bool frame_valid;
+    int dashboard_round;
+
+    OpeningBook book;
+
+    // 单人模式下 AI 最近一次搜索的统计，以及每步之后导出的文件
+    const SearchStats* search_stats;
+    std::string stats_path;
+    bool stats_prometheus;
+
+    // 棋钟：clock_ms 按 color_index 存双方剩余时间，走棋后加上加秒
+    bool clock_enabled;
+    int clock_base_ms;
+    int clock_increment_ms;
+    int clock_ms[2];
+    int clock_round;              // 当前计时的回合
+    std::chrono::steady_clock::time_point turn_start;
+    int time_forfeit;             // 超时的一方，0 表示没有
+
+    int difficulty;               // difficulty_levels 的下标
+
+    // 提示：对当前走棋方做一次多主变例搜索，不改动棋盘
+    Engine analysis;
+    SearchResult hint_lines[HINT_LINES];
+    int hint_count;
+    Bitboard hint_moves;          // 提示走法的起点和终点，与预测格同样高亮
+
+    // 主循环各阶段的延迟，按 l 在棋盘下方显示
+    LatencyProfile latency;
+    bool latency_overlay;
+    uint64_t input_us;            // 最近一次按键从 getch 返回的时刻，这一帧画完后清零
 };
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+
+// 界面主循环各阶段的延迟直方图（HDR 风格）：小于 LATENCY_SUB_COUNT 微秒的值逐一计数，
+// 更大的值每个 2 的幂区间再分 LATENCY_SUB_COUNT / 2 个桶，相对误差不超过 1/32
+#define LATENCY_SUB_BITS  6
+#define LATENCY_SUB_COUNT (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_BITS  36    // 超过约 19 小时的值按上限计
+#define LATENCY_BUCKETS   ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 2) * (LATENCY_SUB_COUNT / 2))
+
+// 主循环的阶段
+#define STAGE_GETCH     0   // getch 等待和读取，包括 ncurses 在其中做的隐式刷新
+#define STAGE_HANDLER   1   // 按键处理（走子、提示搜索等）
+#define STAGE_RULES     2   // update_legal_moves / update_clocks
+#define STAGE_DRAW_UI   3   // draw_ui 写入屏幕缓冲
+#define STAGE_DASHBOARD 4   // draw_dashboard / draw_clocks
+#define STAGE_OUTPUT    5   // doupdate 输出到终端
+#define STAGE_FRAME     6   // 从按键返回到下一帧输出完成
+#define STAGE_AI        7   // AI 走一步
+#define STAGE_COUNT     8
+
+extern const char* const latency_stage_names[STAGE_COUNT];
+
+// 单调时钟，微秒
+uint64_t latency_now_us();
+
+class LatencyHistogram {
+public:
+    LatencyHistogram() { reset(); }
+    void reset();
+    void record(uint64_t us);
+    uint64_t count() const { return total; }
+    uint64_t max() const { return max_value; }
+    double mean() const { return total ? (double)sum / total : 0; }
+    // 至少 p（0 到 100）的样本不超过返回值；返回所在桶的上界，不超过最大值
+    uint64_t percentile(double p) const;
+private:
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max_value;
+};
+
+// 每个阶段一个直方图
+class LatencyProfile {
+public:
+    void record(int stage, uint64_t us) { stages[stage].record(us); }
+    void record_since(int stage, uint64_t start_us) { stages[stage].record(latency_now_us() - start_us); }
+    const LatencyHistogram& stage(int s) const { return stages[s]; }
+    void reset();
+    // 每个阶段一行：次数、平均、p50 / p90 / p99 / p99.9、最大值（微秒）
+    void write(FILE* out) const;
+    bool dump(const char* path) const;
+private:
+    LatencyHistogram stages[STAGE_COUNT];
+};
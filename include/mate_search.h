@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "position.h"
+#include "search_stats.h"
+
+#define MATE_UNKNOWN   0   // 预算用完仍未得出结论
+#define MATE_PROVEN    1   // 找到强制将杀
+#define MATE_DISPROVEN 2   // 给定步数内不存在强制将杀
+
+#define MATE_MAX_MOVES      30   // 2 × 30 - 1 层，不超过 MAX_PLY
+#define MATE_HASH_DEFAULT   16   // MB
+#define MATE_BUCKET_SIZE    4
+
+typedef struct {
+    int max_moves;      // 最多几步杀（攻击方的走法数），0 取 MATE_MAX_MOVES
+    uint64_t nodes;     // 节点上限，0 表示不限
+    bool checks_only;   // 攻击方只走将军的着法，解题更快，但会漏掉含安静着法的杀
+} MateLimits;
+
+typedef struct {
+    int status;
+    int moves;          // 找到的最短的杀是几步杀，只在 MATE_PROVEN 时有效
+    bool shortest;      // 已否定更短的杀，moves 就是最少步数
+    int pv_length;
+    MoveCode pv[MAX_PLY];
+    uint64_t nodes;
+} MateResult;
+
+// pn / dn 都从攻击方看：pn 为 0 表示已证明有杀，dn 为 0 表示已证明无杀
+typedef struct {
+    uint64_t key;
+    uint32_t pn;
+    uint32_t dn;
+    uint32_t work;      // 得出这个结果花费的节点数，替换时保留花费多的
+    int16_t depth;      // 得出结果时的剩余层数
+} MateEntry;
+
+// 深度优先证明数搜索（df-pn）：证明或否定轮到走棋的一方在给定步数内存在强制将杀，
+// 找到杀以后在剩余预算内继续寻找更短的杀。置换表独立于 alpha-beta 搜索，大小决定内存预算
+class MateSolver {
+public:
+    MateSolver();
+    ~MateSolver();
+    void set_hash(size_t mb);
+    void clear();
+    MateResult solve(const Position& root, const MateLimits& limits);
+
+private:
+    MateSolver(const MateSolver&);
+    MateSolver& operator=(const MateSolver&);
+    bool lookup(uint64_t key, int depth, uint32_t& pn, uint32_t& dn) const;
+    int proof_depth(uint64_t key) const;
+    void store(uint64_t key, int depth, uint32_t pn, uint32_t dn, uint32_t work);
+    int generate(MoveCode* moves, bool or_node);
+    bool on_path(uint64_t key, int ply) const;
+    void mid(int depth, int ply, uint32_t th_phi, uint32_t th_delta, uint32_t& pn, uint32_t& dn, bool& dependent);
+    bool prove(int depth, int ply);
+    void extract_pv(int depth, MateResult& result);
+
+    MateEntry* table;
+    size_t bucket_mask;
+    Position pos;
+    int attacker;
+    bool checks_only;
+    uint64_t nodes;
+    uint64_t node_limit;
+    bool aborted;
+    uint64_t path[MAX_PLY];
+};
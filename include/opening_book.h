@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "position.h"
+
+// 开局库条目：某局面下走某一步棋的统计，文件中按 (key, move) 升序排列
+typedef struct {
+    uint64_t key;
+    MoveCode move;
+    uint16_t reserved;
+    uint32_t white_wins;
+    uint32_t draws;
+    uint32_t black_wins;
+} BookEntry;
+
+typedef struct {
+    char magic[8];
+    uint64_t count;
+} BookHeader;
+
+#define BOOK_MAGIC "CHESSBK1"
+
+inline uint32_t book_games(const BookEntry& e) {
+    return e.white_wins + e.draws + e.black_wins;
+}
+
+// 以内存映射方式只读打开开局库，查询为一次二分查找
+class OpeningBook {
+public:
+    OpeningBook() : base(NULL), size(0), entries(NULL), count(0) {}
+    ~OpeningBook() { close(); }
+    bool open(const char* path);
+    void close();
+    bool is_open() const { return entries != NULL; }
+    size_t entry_count() const { return count; }
+
+    // 返回局面 key 下最多 max_entries 个后续走法，按对局数从多到少排列
+    int probe(uint64_t key, BookEntry* out, int max_entries) const;
+
+private:
+    OpeningBook(const OpeningBook&);
+    OpeningBook& operator=(const OpeningBook&);
+    void* base;
+    size_t size;
+    const BookEntry* entries;
+    size_t count;
+};
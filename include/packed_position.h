@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdio>
+#include "position.h"
+
+#define PACKED_WRITER_BUFFER 4096   // 每次写盘的记录数（128KB）
+
+// 训练与调参用的定长局面记录，文件就是这些记录的数组，没有文件头，可直接拼接
+typedef struct {
+    uint64_t occupancy;     // 有子的格子
+    uint8_t pieces[16];     // 按 occupancy 从低位到高位，每个棋子 4 位：白方为类型，黑方为 8 + 类型
+    int16_t score;          // 搜索分数，白方视角
+    int8_t side;            // 1 白方走，-1 黑方走
+    int8_t result;          // 对局结果，白方视角：1 胜，0 和，-1 负
+    uint8_t reserved[4];
+} PackedPosition;
+
+void pack_position(const Position& pos, int score, int result, PackedPosition& out);
+void unpack_position(const PackedPosition& in, Position& pos);
+
+// 第 index 个棋子（按 occupancy 顺序）的编码
+inline int packed_piece(const PackedPosition& p, int index) {
+    int nibble = (p.pieces[index >> 1] >> ((index & 1) * 4)) & 15;
+    return nibble >= 8 ? -(nibble - 8) : nibble;
+}
+
+// 带缓冲的追加写出器：记录先攒在内存里，满了再整块写到文件末尾。
+// 多个线程共用一个写出器时由调用方加锁
+class PackedWriter {
+public:
+    PackedWriter() : file(NULL), count(0), total(0) {}
+    ~PackedWriter() { close(); }
+    // append 为 false 时清空已有文件
+    bool open(const char* path, bool append = true);
+    bool write(const PackedPosition& record);
+    bool flush();
+    void close();
+    uint64_t written() const { return total; }
+private:
+    PackedWriter(const PackedWriter&);
+    PackedWriter& operator=(const PackedWriter&);
+    FILE* file;
+    PackedPosition buffer[PACKED_WRITER_BUFFER];
+    size_t count;
+    uint64_t total;
+};
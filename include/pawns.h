@@ -0,0 +1,21 @@
+#pragma once
+#include "position.h"
+
+#define PAWN_TABLE_SIZE 16384   // 2 的幂
+
+// 兵形评估：叠兵、孤兵、落后兵和通路兵，白方视角，单位与 evaluate 相同
+int evaluate_pawns(const Position& pos);
+
+typedef struct {
+    uint64_t key;
+    int score;
+} PawnEntry;
+
+// 按 pawn_key 直接映射的兵形缓存，每个搜索线程一份，不需要加锁
+class PawnTable {
+public:
+    PawnTable();
+    int probe(const Position& pos);
+private:
+    PawnEntry entries[PAWN_TABLE_SIZE];
+};
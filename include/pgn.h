@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "position.h"
+
+// 对局结果，从白方视角
+#define RESULT_WHITE_WIN  1
+#define RESULT_DRAW       0
+#define RESULT_BLACK_WIN -1
+#define RESULT_UNKNOWN    2
+
+typedef struct {
+    int result;
+    std::string movetext;
+} PgnGame;
+
+// 流式读取 PGN 文件，每次返回一盘棋，内存占用与文件大小无关
+class PgnReader {
+public:
+    PgnReader() : file(NULL), pos(0), len(0) {}
+    ~PgnReader() { close(); }
+    bool open(const char* path);
+    void close();
+    bool next_game(PgnGame& game);
+
+private:
+    bool read_line(std::string& line);
+    FILE* file;
+    char buffer[1 << 16];
+    size_t pos;
+    size_t len;
+    std::string pending; // 已读入但属于下一盘棋的标签行
+};
+
+// 棋谱中的一步：走棋前的局面哈希与所走的棋
+typedef struct {
+    uint64_t key;
+    MoveCode move;
+} PgnPly;
+
+// 从初始局面回放 SAN 棋谱，最多 max_ply 步，遇到无法识别的着法即停止。返回成功回放的步数
+int pgn_replay(const std::string& movetext, int max_ply, PgnPly* plies);
+
+// 在 pos 上解析一步 SAN 着法，失败返回 MOVE_NONE
+MoveCode parse_san(Position& pos, const char* san);
+
+// 执行棋谱着法，包括本项目规则之外的王车易位、吃过路兵与升变
+void apply_pgn_move(Position& pos, MoveCode m);
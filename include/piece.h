@@ -27,8 +27,18 @@ inline const char* get_piece_letter(int piece_val) {
     }
 }
 
-// 棋子分值定义
-int get_piece_value(int piece);
+// 棋子分值定义，编译期可用
+constexpr int get_piece_value(int piece) {
+    switch (piece < 0 ? -piece : piece) {
+        case PAWN:   return 10;
+        case KNIGHT: return 30;
+        case BISHOP: return 30;
+        case ROOK:   return 50;
+        case QUEEN:  return 90;
+        case KING:   return 900;
+        default: return 0;
+    }
+}
 
 void predict_move(int y, int x, std::vector<std::vector<int>>& predicted_moves);
 
@@ -0,0 +1,92 @@
+#pragma once
+#include "bitboard.h"
+#include "piece.h"
+#include "zobrist.h"
+
+// 针对黑棋的位置评估表（值越高越好）
+constexpr int pawn_table[8][8] = {
+    { 0,  0,  0,  0,  0,  0,  0,  0}, // 黑方底线
+    { 5, 10, 10,-20,-20, 10, 10,  5}, // 初始位置（适度惩罚中心兵阻挡出子）
+    { 5, -5,-10,  0,  0,-10, -5,  5},
+    { 0,  0,  0, 20, 20,  0,  0,  0}, // 占据中心
+    { 5,  5, 10, 25, 25, 10,  5,  5}, // 推进
+    {10, 10, 20, 30, 30, 20, 10, 10}, // 威胁
+    {50, 50, 50, 50, 50, 50, 50, 50}, // 接近升变
+    { 0,  0,  0,  0,  0,  0,  0,  0}  // 升变行
+};
+
+constexpr int knight_table[8][8] = {
+    {-50,-40,-30,-30,-30,-30,-40,-50}, // 避开角落
+    {-40,-20,  0,  0,  0,  0,-20,-40},
+    {-30,  0, 10, 15, 15, 10,  0,-30},
+    {-30,  5, 15, 20, 20, 15,  5,-30},
+    {-30,  0, 15, 20, 20, 15,  0,-30},
+    {-30,  5, 10, 15, 15, 10,  5,-30},
+    {-40,-20,  0,  5,  5,  0,-20,-40},
+    {-50,-40,-30,-30,-30,-30,-40,-50}
+};
+
+constexpr int bishop_table[8][8] = {
+    {-20,-10,-10,-10,-10,-10,-10,-20},
+    {-10,  0,  0,  0,  0,  0,  0,-10},
+    {-10,  0,  5, 10, 10,  5,  0,-10},
+    {-10,  5,  5, 10, 10,  5,  5,-10},
+    {-10,  0, 10, 10, 10, 10,  0,-10},
+    {-10, 10, 10, 10, 10, 10, 10,-10},
+    {-10,  5,  0,  0,  0,  0,  5,-10},
+    {-20,-10,-10,-10,-10,-10,-10,-20}
+};
+
+constexpr int rook_table[8][8] = {
+    { 0,  0,  0,  0,  0,  0,  0,  0},
+    { 5, 10, 10, 10, 10, 10, 10,  5}, // 占据对方二线
+    {-5,  0,  0,  0,  0,  0,  0, -5},
+    {-5,  0,  0,  0,  0,  0,  0, -5},
+    {-5,  0,  0,  0,  0,  0,  0, -5},
+    {-5,  0,  0,  0,  0,  0,  0, -5},
+    {-5,  0,  0,  0,  0,  0,  0, -5},
+    { 0,  0,  0,  5,  5,  0,  0,  0}  // 初始位置，鼓励出车
+};
+
+constexpr int queen_table[8][8] = {
+    {-20,-10,-10, -5, -5,-10,-10,-20},
+    {-10,  0,  0,  0,  0,  0,  0,-10},
+    {-10,  0,  5,  5,  5,  5,  0,-10},
+    { -5,  0,  5,  5,  5,  5,  0, -5},
+    {  0,  0,  5,  5,  5,  5,  0, -5},
+    {-10,  5,  5,  5,  5,  5,  0,-10},
+    {-10,  0,  5,  0,  0,  0,  0,-10},
+    {-20,-10,-10, -5, -5,-10,-10,-20}
+};
+
+constexpr int king_table[8][8] = {
+    {-30,-40,-40,-50,-50,-40,-40,-30},
+    {-30,-40,-40,-50,-50,-40,-40,-30},
+    {-30,-40,-40,-50,-50,-40,-40,-30},
+    {-30,-40,-40,-50,-50,-40,-40,-30},
+    {-20,-30,-30,-40,-40,-30,-30,-20},
+    {-10,-20,-20,-20,-20,-20,-20,-10},
+    { 20, 20,  0,  0,  0,  0, 20, 20}, // 王翼或后翼易位后的安全区
+    { 20, 30, 10,  0,  0, 10, 30, 20}  // 初始底线安全位置
+};
+
+// 编译期把六张表合成按 piece_index 和格子下标查询的一张表，
+// 白方棋子的行号已经翻转（表格是按黑方视角写的）
+struct PieceSquareTable {
+    int score[12][64];
+};
+
+constexpr PieceSquareTable make_piece_square_table() {
+    PieceSquareTable t = {};
+    const int (*tables[6])[8] = {pawn_table, knight_table, bishop_table, rook_table, queen_table, king_table};
+    for (int type = PAWN; type <= KING; type++) {
+        for (int sq = 0; sq < 64; sq++) {
+            int r = SQ_Y(sq), c = SQ_X(sq);
+            t.score[piece_index(type)][sq] = tables[type - 1][7 - r][c];
+            t.score[piece_index(-type)][sq] = tables[type - 1][r][c];
+        }
+    }
+    return t;
+}
+
+inline constexpr PieceSquareTable piece_square_table = make_piece_square_table();
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include "bitboard.h"
+#include "cpu.h"
+#include "piece.h"
+
+// 走法编码：低 6 位起点格，接着 6 位终点格，最高 4 位为升变棋子类型（仅棋谱回放使用）
+typedef uint16_t MoveCode;
+
+#define MOVE_NONE 0
+#define MAX_MOVES 256
+
+inline MoveCode encode_move(int from, int to, int promo = 0) {
+    return (MoveCode)(from | (to << 6) | (promo << 12));
+}
+
+inline int move_from(MoveCode m) { return m & 63; }
+inline int move_to(MoveCode m) { return (m >> 6) & 63; }
+inline int move_promo(MoveCode m) { return m >> 12; }
+
+// side 为 1（白）或 -1（黑），数组下标 0 为白、1 为黑
+inline int color_index(int side) {
+    return side > 0 ? 0 : 1;
+}
+
+// 坐标形式输出，例如 "e2e4"，buf 至少 6 字节
+void move_to_string(MoveCode m, char* buf);
+
+// 局面状态，只针对轮到走棋的一方
+#define STATUS_NORMAL    0
+#define STATUS_CHECK     1
+#define STATUS_CHECKMATE 2
+#define STATUS_STALEMATE 3
+
+// 撤销走法所需的信息
+typedef struct {
+    MoveCode move;
+    int8_t moved;
+    int8_t captured;
+    uint64_t key;
+    uint64_t pawn_key;
+} Undo;
+
+// 与全局 board 编码一致的局面，但不依赖全局变量，可在多个线程中独立使用
+class Position {
+public:
+    int8_t squares[64];
+    Bitboard by_color[2];
+    Bitboard by_type[7];
+    int king_sq[2];
+    int side;
+    uint64_t key;
+    uint64_t pawn_key;  // 只包含兵的 Zobrist 哈希，用于兵形缓存
+
+    void clear();
+    void set_board(const int b[8][8], int side_to_move);
+    void to_board(int b[8][8]) const;
+
+    // FEN 只读取棋子布局与走棋方，易位和过路兵字段被忽略
+    bool set_fen(const char* fen);
+    // 外部输入用的严格版本：每个横排正好 8 格，双方各一个王，不轮到走棋的一方不能正被将军
+    bool set_fen_strict(const char* fen);
+    void to_fen(char* buf) const;
+
+    void put_piece(int sq, int piece);
+    void remove_piece(int sq);
+
+    void do_move(MoveCode m, Undo& undo);
+    void undo_move(const Undo& undo);
+
+    Bitboard occupied() const { return by_color[0] | by_color[1]; }
+    Bitboard pieces(int s, int type) const { return by_color[color_index(s)] & by_type[type]; }
+
+    // attacker_side 一方所有攻击 sq 的棋子
+    Bitboard attackers_to(int sq, int attacker_side) const { return attackers_to(sq, attacker_side, occupied()); }
+    Bitboard attackers_to(int sq, int attacker_side, Bitboard occ) const {
+        return cpu_kernels.attackers_to(*this, sq, attacker_side, occ);
+    }
+    bool is_attacked(int sq, int attacker_side) const { return attackers_to(sq, attacker_side) != 0; }
+    bool in_check(int s) const {
+        int ksq = king_sq[color_index(s)];
+        return ksq >= 0 && is_attacked(ksq, -s);
+    }
+
+    // 攻击方和指令集在编译期确定的版本，兵的方向和颜色下标不再运行时判断
+    template <int Attacker, int Isa = CPU_GENERIC>
+    CPU_KERNEL_INLINE Bitboard attackers(int sq, Bitboard occ) const {
+        constexpr int c = Attacker > 0 ? 0 : 1;
+        Bitboard diagonal = by_type[BISHOP] | by_type[QUEEN];
+        Bitboard straight = by_type[ROOK] | by_type[QUEEN];
+        // 从目标格反向查找：被白兵攻击的格子等价于从该格按黑兵方向看出去的格子
+        Bitboard found = (pawn_attacks[c ^ 1][sq] & by_type[PAWN])
+                       | (knight_attacks[sq] & by_type[KNIGHT])
+                       | (king_attacks[sq] & by_type[KING])
+                       | (slider_bishop_attacks<Isa>(sq, occ) & diagonal)
+                       | (slider_rook_attacks<Isa>(sq, occ) & straight);
+        return found & by_color[c];
+    }
+};
+
+// 按本项目规则生成走法（无王车易位、吃过路兵与升变），返回走法数量
+int generate_pseudo_moves(const Position& pos, MoveCode* list);
+int generate_legal_moves(Position& pos, MoveCode* list);
+
+// 被将军时只生成应将走法：王的移动、吃掉将军的棋子、垫将；双将时只有王能动
+int generate_evasions(Position& pos, MoveCode* list);
+
+bool has_legal_move(Position& pos);
+int position_status(Position& pos);
+
+#define STATUS_CACHE_SIZE 4096
+
+// 按局面哈希缓存的局面状态，直接映射，冲突时覆盖
+class StatusCache {
+public:
+    StatusCache() { clear(); }
+    void clear();
+    int probe(Position& pos);
+
+private:
+    uint64_t keys[STATUS_CACHE_SIZE];
+    int8_t status[STATUS_CACHE_SIZE];
+};
+
+// 只生成吃子走法（伪合法），供静态搜索使用
+int generate_captures(const Position& pos, MoveCode* list);
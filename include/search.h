@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "position.h"
+#include "search_stats.h"
+#include "tablebase.h"
+#include "time_manager.h"
+#include "tt.h"
+
+#define SCORE_INF         32000
+#define SCORE_MATE        31000
+// 残局库的杀在搜索树的叶子上再加最多 TB_MAX_PLIES 半步，也要落在杀棋分范围内
+#define SCORE_MATE_IN_MAX (SCORE_MATE - MAX_PLY - TB_MAX_PLIES)
+#define MAX_MULTIPV       8
+
+struct SearchLimits {
+    int depth;          // 最大迭代深度，0 表示不限
+    uint64_t nodes;     // 节点上限，0 表示不限
+    int time_ms;        // 固定每步用时（毫秒），0 表示不限
+    int clock_ms;       // 棋钟剩余时间，大于 0 时由时间管理分配每步用时
+    int increment_ms;   // 每步加秒
+    int moves_to_go;    // 距下一次加时的步数，0 表示未知
+    int eval_noise;     // 评估随机扰动幅度（分），0 表示关闭
+    uint32_t seed;      // 扰动种子，相同种子得到相同的搜索
+    int multipv;        // 返回的主变例条数，0 和 1 都只搜最佳走法
+};
+
+typedef struct {
+    MoveCode best_move;
+    int score;
+    int depth;
+    int pv_length;
+    MoveCode pv[MAX_PLY];
+} SearchResult;
+
+class SearchWorker;
+
+// 迭代加深 alpha-beta 搜索，多线程时各线程共享置换表（Lazy SMP），结果取主线程
+class Engine {
+public:
+    Engine();
+    ~Engine();
+    void set_threads(int count);
+    void set_hash(size_t mb);
+    void new_game();
+    SearchResult search(const Position& pos, const SearchLimits& limits);
+    // 一次搜索得到前 count 个走法及其主变例，按分数从高到低写入 lines，返回条数
+    int analyze(const Position& pos, const SearchLimits& limits, int count, SearchResult* lines);
+    const SearchStats& last_stats() const { return stats; }
+    int thread_count() const { return (int)workers.size(); }
+    int tt_page_type() const { return tt.page_type(); }
+
+private:
+    Engine(const Engine&);
+    Engine& operator=(const Engine&);
+    friend class SearchWorker;
+    void check_limits();
+    double elapsed_ms() const;
+    void clear_hash();
+
+    TranspositionTable tt;
+    std::vector<SearchWorker*> workers;
+    // 辅助线程在 set_threads 时创建，之后一直等待；search 只改 search_id 唤醒它们，不再创建线程
+    std::vector<std::thread> helpers;
+    std::mutex pool_mutex;
+    std::condition_variable pool_start;
+    std::condition_variable pool_done;
+    uint64_t search_id;
+    int helpers_running;
+    bool pool_quit;
+    bool pool_clear;          // 这次唤醒辅助线程是为了清零置换表，不是搜索
+    Position root;
+    SearchCounters* counters; // 每个线程一份，连续存放、按缓存行对齐
+    std::atomic<bool> stop;
+    SearchLimits limits;
+    TimeManager time;
+    std::chrono::steady_clock::time_point start_time;
+    SearchStats stats;
+};
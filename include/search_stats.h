@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+#define MAX_PLY 64
+
+// 定义 CHESS_NO_STATS 时，除节点数外的统计全部编译掉
+#ifdef CHESS_NO_STATS
+#define SEARCH_STATS_ENABLED 0
+#else
+#define SEARCH_STATS_ENABLED 1
+#endif
+
+// 只由所属搜索线程写入，其他线程可以随时无锁读取
+inline void counter_add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// 每个搜索线程一份，按缓存行对齐，避免线程之间的伪共享
+struct alignas(64) SearchCounters {
+    std::atomic<uint64_t> nodes;
+#if SEARCH_STATS_ENABLED
+    std::atomic<uint64_t> qnodes;
+    std::atomic<uint64_t> tt_probes;
+    std::atomic<uint64_t> tt_hits;
+    std::atomic<uint64_t> beta_cutoffs;
+    std::atomic<uint64_t> first_move_cutoffs;
+    std::atomic<int> seldepth;
+#endif
+
+    void reset();
+};
+
+#if SEARCH_STATS_ENABLED
+#define STAT_ADD(counters, field, value) counter_add((counters).field, (value))
+#define STAT_MAX(counters, field, value) \
+    do { if ((value) > (counters).field.load(std::memory_order_relaxed)) \
+             (counters).field.store((value), std::memory_order_relaxed); } while (0)
+#else
+#define STAT_ADD(counters, field, value) ((void)0)
+#define STAT_MAX(counters, field, value) ((void)0)
+#endif
+
+// 迭代加深中每一轮的记录
+typedef struct {
+    int depth;
+    int score;
+    uint64_t nodes;
+    double time_ms;
+} IterationStats;
+
+// 一次搜索结束后汇总的统计
+typedef struct {
+    int threads;
+    int depth;
+    int seldepth;
+    uint64_t nodes;
+    uint64_t qnodes;
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    uint64_t beta_cutoffs;
+    uint64_t first_move_cutoffs;
+    double time_ms;
+    uint64_t nps;
+    uint64_t allocations;   // 搜索期间的堆分配次数，只在 CHESS_ALLOC_COUNT 构建中统计
+    int iteration_count;
+    IterationStats iterations[MAX_PLY];
+} SearchStats;
+
+// 汇总 count 个线程的计数器
+void aggregate_counters(const SearchCounters* counters, int count, SearchStats& stats);
+
+// 导出为 JSON 或 Prometheus 文本格式，写入失败返回 false
+bool write_stats_json(const SearchStats& stats, FILE* out);
+bool write_stats_prometheus(const SearchStats& stats, FILE* out);
+bool dump_stats(const SearchStats& stats, const char* path, bool prometheus);
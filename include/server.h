@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// 无界面的多局面引擎服务：本地 Unix 套接字，每行一个 JSON 请求，或定长二进制帧。
+// 主线程用 epoll 处理所有连接和会话，AI 走子交给固定数量的工作线程，每个工作线程一个引擎
+#define SERVER_MAX_SESSIONS 65536   // 会话号低 16 位为池中下标
+#define SERVER_MAX_LINE     4096    // 单行请求上限，超过后断开连接
+#define SERVER_MAX_OUTPUT   (1 << 20)   // 每个连接积压的应答上限，超过后断开连接
+
+// 二进制帧：连接的第一个字节为 SERVER_BINARY_MAGIC 时整条连接都按二进制处理
+#define SERVER_BINARY_MAGIC 0xC5
+
+// 请求类型，JSON 中为 "new" / "move" / "ai" / "status" / "close"
+#define OP_NEW    1
+#define OP_MOVE   2
+#define OP_AI     3
+#define OP_STATUS 4
+#define OP_CLOSE  5
+
+// 二进制请求和应答都是 16 字节，小端
+typedef struct {
+    uint8_t magic;
+    uint8_t op;
+    uint16_t move;          // OP_MOVE 的走法编码
+    uint32_t session;
+    uint32_t nodes;         // OP_AI 的节点预算，0 取默认值
+    uint32_t deadline_ms;   // OP_AI 从收到请求算起的期限，0 表示不限
+} BinaryRequest;
+
+typedef struct {
+    uint8_t magic;
+    uint8_t error;          // 0 成功，其余为 SERVER_ERROR_*
+    uint16_t move;          // OP_AI 走出的着法
+    uint32_t session;
+    int16_t score;
+    uint8_t status;         // STATUS_*，轮到走棋的一方
+    int8_t side;
+    uint32_t nodes;
+} BinaryResponse;
+
+#define SERVER_ERROR_BAD_REQUEST 1
+#define SERVER_ERROR_NO_SESSION  2
+#define SERVER_ERROR_ILLEGAL     3
+#define SERVER_ERROR_BUSY        4   // 会话正在搜索，或者任务队列已满
+#define SERVER_ERROR_DEADLINE    5
+#define SERVER_ERROR_FULL        6   // 会话池已满
+
+typedef struct {
+    const char* socket_path;
+    int workers;            // AI 工作线程数
+    int queue_size;         // 等待中的 AI 任务上限，满了直接拒绝
+    int max_sessions;
+    int hash_mb;            // 每个工作线程的置换表大小
+    uint64_t default_nodes; // AI 请求没有给出预算时的节点数
+} ServerOptions;
+
+// 运行到收到 SIGINT / SIGTERM 为止，返回进程退出码
+int run_server(const ServerOptions& options);
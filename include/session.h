@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <ncurses.h>
+
+// 会话录制与回放：界面的所有输入都经过 session_getch / session_getmouse。
+// 录制时把按键、时间间隔和鼠标事件写成紧凑的二进制日志；回放时按顺序读出，
+// 配合无终端的 ncurses 屏幕（newterm 到 /dev/null）就能在自动化环境里重跑整局
+#define SESSION_MAGIC   0x31524543u     // "CER1"
+#define SESSION_VERSION 2
+#define SESSION_PATH_SIZE 256
+
+// 文件头之后每个事件：距上一个事件的微秒数、按键（zigzag），都是 LEB128 变长整数；
+// 按键为 KEY_MOUSE 时再跟鼠标的 x、y 和按键状态。计时对局中 getch 超时返回的 ERR 也作为事件记录
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seed;              // rand() 的种子：AI 扰动和开局库选择都来自它
+    int32_t clock_base_ms;      // 棋钟设置，0 表示不计时
+    int32_t clock_increment_ms;
+    char book[SESSION_PATH_SIZE];   // 开局库路径
+    char tb[SESSION_PATH_SIZE];     // 残局库路径，空串表示没有加载
+} SessionHeader;
+
+// 开始录制，失败时返回 false
+bool session_record(const char* path, const SessionHeader& header);
+// 打开日志准备回放，读出文件头；realtime 为 true 时按录制时的间隔送出按键，否则尽快送出
+bool session_replay(const char* path, SessionHeader& header, bool realtime);
+// 结束录制或回放，录制的日志在这里写完
+void session_close();
+
+// 替代 getch：录制时记录读到的按键和超时，回放时返回日志中的下一个事件；
+// 日志读完之后一直返回 'q'，并且 session_finished() 变为 true
+int session_getch();
+// 替代 getmouse：返回与最近一个 KEY_MOUSE 对应的事件
+int session_getmouse(MEVENT* event);
+bool session_replaying();
+bool session_finished();
+uint64_t session_event_count();
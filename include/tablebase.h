@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "position.h"
+
+// 残局库：chess_tbgen 离线生成，运行时 mmap 文件直接查询。
+// 每种子力组合两个文件：<名字>.dtm 记录距将杀的半步数，<名字>.wdl 只记录胜负和，体积更小
+#define TB_MAX_PIECES 5
+#define TB_NAME_SIZE  16
+
+// 文件中每个局面一个字节：DTM 表为距将杀的半步数（奇数轮到走棋的一方胜，偶数负），
+// 另有和棋、非法两个特殊值；WDL 表为 TB_LOSS / TB_DRAW_WDL / TB_WIN
+#define TB_MAX_PLIES 252
+#define TB_DRAW      253
+#define TB_ILLEGAL   254
+
+#define TB_LOSS     0
+#define TB_DRAW_WDL 1
+#define TB_WIN      2
+
+#define TB_KIND_WDL 0
+#define TB_KIND_DTM 1
+
+#define TB_MAGIC      0x31425443u   // "CTB1"
+#define TB_BLOCK_SIZE 4096          // 每块的局面数，块内游程编码，查询时只解一块
+
+typedef struct {
+    uint32_t magic;
+    uint32_t kind;
+    char name[TB_NAME_SIZE];
+    uint64_t size;          // 局面数
+    uint32_t block_size;
+    uint32_t block_count;
+    // 后面紧跟 block_count + 1 个 uint64_t 偏移（相对数据区开头），然后是数据区
+} TbHeader;
+
+// 子力组合的布局。棋子顺序：白王、黑王，然后白方、黑方其余棋子按 Q R B N P 排列。
+// 无兵时白王对称到 a8-d8-d5 三角内的 10 格，有兵时只能左右对称，白王在左半边 32 格；
+// 其余每个棋子 64 格，再乘以走棋方 2 种
+typedef struct {
+    char name[TB_NAME_SIZE];
+    int count;
+    int8_t pieces[TB_MAX_PIECES];
+    bool pawns;
+    int king_slots;
+    uint64_t half_size;     // 一方走棋的局面数
+    uint64_t size;
+} TbLayout;
+
+// 解析 "KQvKR" 形式的名字，格式不对时返回 false
+bool tb_layout(const char* name, TbLayout& layout);
+
+// 把 "KRvKQ" 这样的名字换成生成表时使用的写法（强的一方在前），格式不对时返回 false
+bool tb_canonical_name(const char* name, char* out);
+
+// 局面（已按布局的颜色排列）在表中的下标，取所有对称变换中最小的一个
+uint64_t tb_index(const TbLayout& layout, const Position& pos);
+
+// 由下标还原局面；棋子重叠或不是规范下标时返回 false
+bool tb_decode(const TbLayout& layout, uint64_t index, Position& pos);
+
+// 游程编码写入文件；values 为每个局面一个字节，非法局面可以编码成任意值
+bool tb_write(const char* path, const TbLayout& layout, int kind, const uint8_t* values);
+
+// 加载单个文件或目录下的所有 .dtm / .wdl 文件，返回成功加载的表数
+int tb_load(const char* path);
+void tb_unload();
+// 已加载的表中最多的棋子数，没有表时为 0
+int tb_max_pieces();
+
+// 只剩两个王时直接返回和棋，不需要表。
+// DTM 查询：wdl 为 TB_LOSS / TB_DRAW_WDL / TB_WIN，plies 为距将杀的半步数；没有对应的表时返回 false
+bool tb_probe_dtm(const Position& pos, int& wdl, int& plies);
+// WDL 查询，优先使用 .wdl 文件，没有时从 .dtm 推出
+bool tb_probe_wdl(const Position& pos, int& wdl);
@@ -0,0 +1,28 @@
+#pragma once
+#include "position.h"
+
+struct SearchLimits;
+
+// 根据棋钟分配每步的软、硬时间上限。软上限决定是否开始下一轮迭代，
+// 硬上限到达时立即停止搜索
+class TimeManager {
+public:
+    TimeManager() : enabled(false), soft_ms(0), hard_ms(0) {}
+    void start(const SearchLimits& limits);
+
+    // 每完成一轮迭代调用一次，返回 true 表示不再开始下一轮。
+    // best_share 为本轮最佳走法子树占根节点总节点数的比例
+    bool stop_after_iteration(double elapsed_ms, int depth, MoveCode best, int score, double best_share);
+
+    bool enabled;
+    double soft_ms;
+    double hard_ms;
+
+private:
+    bool adaptive;          // 固定每步用时时不做调整
+    MoveCode last_best;
+    int last_score;
+    int stable_iterations;
+    double instability;     // 最佳走法变化越频繁越大，每轮衰减一半
+    double fail_low_factor;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "position.h"
+
+#define BOUND_NONE  0
+#define BOUND_UPPER 1
+#define BOUND_LOWER 2
+#define BOUND_EXACT 3
+
+// 置换表条目：data 打包走法、分数、深度与边界，key 字段保存 key ^ data，
+// 多线程同时读写时若条目被撕裂，校验会失败而不会返回错误的数据
+typedef struct {
+    uint64_t key;
+    uint64_t data;
+} TTSlot;
+
+typedef struct {
+    MoveCode move;
+    int score;
+    int depth;
+    int bound;
+} TTEntry;
+
+#define TT_BUCKET_SIZE 4 // 4 × 16 字节，正好一个缓存行
+
+// 置换表所用内存页的类型
+#define TT_PAGES_NORMAL      0
+#define TT_PAGES_TRANSPARENT 1 // 透明大页（madvise）
+#define TT_PAGES_HUGE        2 // hugetlbfs 预留的大页
+
+// 所有搜索线程共享的置换表
+class TranspositionTable {
+public:
+    TranspositionTable() : slots(NULL), bucket_mask(0), generation(0), mapping(NULL), mapping_size(0), pages(TT_PAGES_NORMAL) {}
+    ~TranspositionTable();
+    // 只映射内存不写入，物理页在第一次清零时由写入的线程分配
+    void resize(size_t mb);
+    void clear() { clear_slice(0, 1); }
+    // 按大页把表切成 count 段，清零第 index 段。搜索线程各清一段，首次写入决定物理页落在哪个 NUMA 节点；
+    // 表较小时由第 0 段清零整张表，其余段直接返回
+    void clear_slice(int index, int count);
+    void new_search() { generation = (generation + 1) & 0xFF; }
+    bool probe(uint64_t key, TTEntry& entry) const;
+    void store(uint64_t key, MoveCode move, int score, int depth, int bound);
+    size_t size_mb() const { return slots ? (bucket_mask + 1) * TT_BUCKET_SIZE * sizeof(TTSlot) >> 20 : 0; }
+    int page_type() const { return pages; }
+
+    // 走完一步、子节点的哈希已经算出时调用，在子节点探测之前把所在的桶取进缓存
+    void prefetch(uint64_t key) const {
+        __builtin_prefetch(slots + (key & bucket_mask) * TT_BUCKET_SIZE);
+    }
+
+private:
+    TranspositionTable(const TranspositionTable&);
+    TranspositionTable& operator=(const TranspositionTable&);
+    void release();
+    TTSlot* slots;
+    size_t bucket_mask;
+    int generation;
+    void* mapping;        // mmap 返回的区域，slots 在其中按大页对齐
+    size_t mapping_size;
+    int pages;
+};
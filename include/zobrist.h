@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+
+// splitmix64，固定种子保证开局库在不同机器上生成的键一致
+constexpr uint64_t next_random(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Zobrist 哈希：12 种棋子 × 64 格，外加轮到黑方走时异或的 side 键，编译期生成
+struct ZobristKeys {
+    uint64_t pieces[12][64];
+    uint64_t side;
+};
+
+constexpr ZobristKeys make_zobrist_keys() {
+    ZobristKeys k = {};
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    for (int p = 0; p < 12; p++) {
+        for (int sq = 0; sq < 64; sq++) {
+            k.pieces[p][sq] = next_random(state);
+        }
+    }
+    k.side = next_random(state);
+    return k;
+}
+
+inline constexpr ZobristKeys zobrist_keys = make_zobrist_keys();
+
+inline constexpr const uint64_t (&zobrist_pieces)[12][64] = zobrist_keys.pieces;
+inline constexpr uint64_t zobrist_side = zobrist_keys.side;
+
+// 白方棋子 1..6 映射到 0..5，黑方 -1..-6 映射到 6..11
+constexpr int piece_index(int piece) {
+    return piece > 0 ? piece - 1 : 5 - piece;
+}
+
+inline uint64_t zobrist_piece(int piece, int sq) {
+    return zobrist_pieces[piece_index(piece)][sq];
+}
+
+// 计算 board 格式棋盘的哈希值，side 为轮到走棋的一方（1 白，-1 黑）
+uint64_t compute_board_key(const int b[8][8], int side);
@@ -1,164 +1,104 @@
 #include "ai_player.h"
 #include "piece.h"
+#include "evaluate.h"
+#include "piece_square.h"
+#include "zobrist.h"
+#include <cstring>
 
-// 针对黑棋的位置评估表（值越高越好）
-int pawn_table[8][8] = {
-    { 0,  0,  0,  0,  0,  0,  0,  0}, // 黑方底线
-    { 5, 10, 10,-20,-20, 10, 10,  5}, // 初始位置（适度惩罚中心兵阻挡出子）
-    { 5, -5,-10,  0,  0,-10, -5,  5},
-    { 0,  0,  0, 20, 20,  0,  0,  0}, // 占据中心
-    { 5,  5, 10, 25, 25, 10,  5,  5}, // 推进
-    {10, 10, 20, 30, 30, 20, 10, 10}, // 威胁
-    {50, 50, 50, 50, 50, 50, 50, 50}, // 接近升变
-    { 0,  0,  0,  0,  0,  0,  0,  0}  // 升变行
-};
-
-int knight_table[8][8] = {
-    {-50,-40,-30,-30,-30,-30,-40,-50}, // 避开角落
-    {-40,-20,  0,  0,  0,  0,-20,-40},
-    {-30,  0, 10, 15, 15, 10,  0,-30},
-    {-30,  5, 15, 20, 20, 15,  5,-30},
-    {-30,  0, 15, 20, 20, 15,  0,-30},
-    {-30,  5, 10, 15, 15, 10,  5,-30},
-    {-40,-20,  0,  5,  5,  0,-20,-40},
-    {-50,-40,-30,-30,-30,-30,-40,-50}
-};
-
-int bishop_table[8][8] = {
-    {-20,-10,-10,-10,-10,-10,-10,-20},
-    {-10,  0,  0,  0,  0,  0,  0,-10},
-    {-10,  0,  5, 10, 10,  5,  0,-10},
-    {-10,  5,  5, 10, 10,  5,  5,-10},
-    {-10,  0, 10, 10, 10, 10,  0,-10},
-    {-10, 10, 10, 10, 10, 10, 10,-10},
-    {-10,  5,  0,  0,  0,  0,  5,-10},
-    {-20,-10,-10,-10,-10,-10,-10,-20}
-};
-
-int rook_table[8][8] = {
-    { 0,  0,  0,  0,  0,  0,  0,  0},
-    { 5, 10, 10, 10, 10, 10, 10,  5}, // 占据对方二线
-    {-5,  0,  0,  0,  0,  0,  0, -5},
-    {-5,  0,  0,  0,  0,  0,  0, -5},
-    {-5,  0,  0,  0,  0,  0,  0, -5},
-    {-5,  0,  0,  0,  0,  0,  0, -5},
-    {-5,  0,  0,  0,  0,  0,  0, -5},
-    { 0,  0,  0,  5,  5,  0,  0,  0}  // 初始位置，鼓励出车
-};
-
-int queen_table[8][8] = {
-    {-20,-10,-10, -5, -5,-10,-10,-20},
-    {-10,  0,  0,  0,  0,  0,  0,-10},
-    {-10,  0,  5,  5,  5,  5,  0,-10},
-    { -5,  0,  5,  5,  5,  5,  0, -5},
-    {  0,  0,  5,  5,  5,  5,  0, -5},
-    {-10,  5,  5,  5,  5,  5,  0,-10},
-    {-10,  0,  5,  0,  0,  0,  0,-10},
-    {-20,-10,-10, -5, -5,-10,-10,-20}
-};
+int get_positional_score(int piece, int r, int c) {
+    return piece != EMPTY ? piece_square_table.score[piece_index(piece)][SQ(r, c)] : 0;
+}
 
-int king_table[8][8] = {
-    {-30,-40,-40,-50,-50,-40,-40,-30},
-    {-30,-40,-40,-50,-50,-40,-40,-30},
-    {-30,-40,-40,-50,-50,-40,-40,-30},
-    {-30,-40,-40,-50,-50,-40,-40,-30},
-    {-20,-30,-30,-40,-40,-30,-30,-20},
-    {-10,-20,-20,-20,-20,-20,-20,-10},
-    { 20, 20,  0,  0,  0,  0, 20, 20}, // 王翼或后翼易位后的安全区
-    { 20, 30, 10,  0,  0, 10, 30, 20}  // 初始底线安全位置
+const Difficulty difficulty_levels[DIFFICULTY_COUNT] = {
+    {"Easy",   2,    2000, 60},
+    {"Medium", 4,   30000, 15},
+    {"Hard",   8,  300000,  3},
+    {"Expert", 0, 3000000,  1},
 };
 
-int get_positional_score(int piece, int r, int c) {
-    int type = abs(piece);
-    bool is_white = (piece > 0);
-    
-    // 如果是白方，需要反转行号来读取表格（因为表格是按黑方视角写的）
-    int table_r = is_white ? (7 - r) : r;
-    int table_c = c;
+AIPlayer::AIPlayer() : book(NULL), used_book(false) {
+    memset(&limits, 0, sizeof(limits));
+    set_difficulty(DIFFICULTY_DEFAULT);
+}
 
-    switch(type) {
-        case 1: return pawn_table[table_r][table_c];
-        case 2: return knight_table[table_r][table_c];
-        case 3: return bishop_table[table_r][table_c];
-        case 4: return rook_table[table_r][table_c];
-        case 5: return queen_table[table_r][table_c];
-        case 6: return king_table[table_r][table_c];
-        default: return 0;
+void AIPlayer::set_difficulty(int level) {
+    if (level < 0 || level >= DIFFICULTY_COUNT) {
+        level = DIFFICULTY_DEFAULT;
     }
+    limits.depth = difficulty_levels[level].depth;
+    limits.nodes = difficulty_levels[level].nodes;
+    limits.eval_noise = difficulty_levels[level].eval_noise;
+    limits.time_ms = 0;
 }
 
-int AIPlayer::make_move() {
-    Move best_move = {-1, -1, -1, -1, -20000};
-    std::vector<Move> equal_best_moves; // 存储得分相同的最佳走法
-
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (board[i][j] < 0) { 
-                int piece_type = abs(board[i][j]);
-                
-                for (int ty = 0; ty < 8; ty++) {
-                    for (int tx = 0; tx < 8; tx++) {
-                        if (try_move(i, j, ty, tx)) {
-                            int current_score = 0;
-
-                            // --- 1. 进攻得分 (吃子) ---
-                            if (board[ty][tx] > 0) {
-                                current_score += get_piece_value(board[ty][tx]) * 10; 
-                            }
-
-                            // --- 2. 位置权重得分 ---
-                            int piece_type = abs(board[i][j]);
-                            current_score += (get_positional_score(board[i][j], ty, tx) - 
-                                            get_positional_score(board[i][j], i, j));
-
-                            // --- 3. 防守逻辑：检测移动后的安全性 ---
-                            // 模拟执行移动，判断移动后目标点是否会被白方吃掉
-                            // 暂时修改棋盘进行检测
-                            int temp_piece = board[ty][tx];
-                            board[ty][tx] = board[i][j];
-                            board[i][j] = 0;
-
-                            if (is_attacked(ty, tx, 1)) { // 如果被白方攻击
-                                // 惩罚分数 = 被吃掉的棋子价值
-                                // 这样 AI 就会意识到：虽然能吃个兵，但丢个后是不划算的
-                                current_score -= get_piece_value(board[ty][tx]) * 10;
-                            }
-                            
-                            // 特殊防守：如果这个棋子在原位本来就在被攻击，现在逃跑了，应该给加分
-                            // (这可以让 AI 学会“逃跑”)
-                            if (is_attacked(i, j, 1)) { 
-                                current_score += get_piece_value(board[ty][tx]) * 5; 
-                            }
+// 按开局库中各走法的对局数加权随机选择，只考虑本项目规则下合法的走法
+bool AIPlayer::book_move(Move& move) {
+    if (!book || !book->is_open()) {
+        return false;
+    }
+    BookEntry entries[16];
+    int n = book->probe(compute_board_key(board, -1), entries, 16);
+
+    Move candidates[16];
+    int weights[16];
+    int count = 0, total = 0;
+    for (int i = 0; i < n; i++) {
+        int from = move_from(entries[i].move), to = move_to(entries[i].move);
+        Move m = {SQ_Y(from), SQ_X(from), SQ_Y(to), SQ_X(to), 0};
+        if (move_promo(entries[i].move) != 0 || board[m.sy][m.sx] >= 0 || !try_move(m.sy, m.sx, m.dy, m.dx)) {
+            continue;
+        }
+        candidates[count] = m;
+        weights[count] = book_games(entries[i]);
+        total += weights[count];
+        count++;
+    }
+    if (total == 0) {
+        return false;
+    }
 
-                            // 还原棋盘
-                            board[i][j] = board[ty][tx];
-                            board[ty][tx] = temp_piece;
+    int r = rand() % total;
+    for (int i = 0; i < count; i++) {
+        if (r < weights[i]) {
+            move = candidates[i];
+            return true;
+        }
+        r -= weights[i];
+    }
+    return false;
+}
 
-                            // --- 4. 随机扰动 ---
-                            current_score += rand() % 2;
+// 启用棋钟后由时间管理决定每步用时，难度的节点和深度上限仍然有效
+void AIPlayer::set_clock(int remaining_ms, int increment_ms) {
+    limits.clock_ms = remaining_ms > 1 ? remaining_ms : 1;
+    limits.increment_ms = increment_ms;
+}
 
-                            if (current_score > best_move.score) {
-                                best_move.score = current_score;
-                                equal_best_moves.clear();
-                                Move m = {i, j, ty, tx, current_score};
-                                equal_best_moves.push_back(m);
-                            } else if (current_score == best_move.score) {
-                                Move m = {i, j, ty, tx, current_score};
-                                equal_best_moves.push_back(m);
-                            }
-                        }
-                    }
-                }
-            }
-        }
+int AIPlayer::make_move() {
+    Move book_choice;
+    used_book = book_move(book_choice);
+    if (used_book) {
+        return execute_move(book_choice);
     }
 
-    // 从所有得分最高的走法中随机选一个，彻底解决“重复走法”
-    if (!equal_best_moves.empty()) {
-        int idx = rand() % equal_best_moves.size();
-        return execute_move(equal_best_moves[idx]);
+    Position pos;
+    pos.set_board(board, -1);
+    // 每步换一个扰动种子，相同局面下不会总是走同一步
+    limits.seed = rand();
+    SearchResult result = engine.search(pos, limits);
+    if (result.best_move == MOVE_NONE) {
+        return 0;
     }
-    return 0;
+
+    int from = move_from(result.best_move), to = move_to(result.best_move);
+    Move move = {SQ_Y(from), SQ_X(from), SQ_Y(to), SQ_X(to), result.score};
+    return execute_move(move);
+}
+
+MateResult AIPlayer::find_mate(int side, const MateLimits& mate_limits) {
+    Position pos;
+    pos.set_board(board, side);
+    return mate_solver.solve(pos, mate_limits);
 }
 
 int AIPlayer::execute_move(Move& move) {
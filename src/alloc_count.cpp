@@ -0,0 +1,44 @@
+#include "alloc_count.h"
+
+#ifdef CHESS_ALLOC_COUNT
+#include <cstdlib>
+#include <new>
+
+// 每个线程各自计数，搜索线程只看自己的增量，不受其他线程的影响
+static thread_local uint64_t allocations = 0;
+
+uint64_t alloc_count() {
+    return allocations;
+}
+
+// 数组、nothrow 和带大小的版本在标准库中都转发到这几个函数
+void* operator new(std::size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    allocations++;
+    void* p = NULL;
+    if (posix_memalign(&p, (std::size_t)align < sizeof(void*) ? sizeof(void*) : (std::size_t)align, size ? size : 1) != 0) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    free(p);
+}
+#else
+uint64_t alloc_count() {
+    return 0;
+}
+#endif
@@ -0,0 +1,126 @@
+#include "bench.h"
+#include "search.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static const char* bench_fens[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1",
+    "rnbqkb1r/pppp1ppp/5n2/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w - - 2 3",
+    "r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b - - 3 3",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w - - 0 8",
+    "r2q1rk1/1b1nbppp/p2ppn2/1p6/3NP3/1BN1B3/PPP1QPPP/R4RK1 w - - 0 11",
+    "2rq1rk1/pb1nbppp/1p2pn2/2p5/2PP4/1PN1PN2/PB2BPPP/2RQ1RK1 b - - 0 12",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w - - 0 1",
+    "8/5k2/3p4/1p1P4/1P3K2/8/8/8 w - - 0 1",
+    "8/8/4kp2/8/3R4/5K2/5P2/8 w - - 0 1",
+    "6k1/5pp1/8/8/8/8/5PP1/3R2K1 b - - 0 1",
+    "rnbqkbnr/ppp2ppp/8/1B1pp3/4P3/8/PPPP1PPP/RNBQK1NR b - - 1 3",
+    "4k3/8/8/8/8/8/4q3/4K3 w - - 0 1",
+};
+
+typedef struct {
+    unsigned long long nodes;
+    unsigned long long allocations;
+    int score;
+    char best[6];
+} BenchEntry;
+
+// 每个线程的结果各写各的，join 之后再合并
+typedef struct {
+    bool ok;
+    int pages;
+} BenchThread;
+
+int run_search_bench(int depth, int threads, int hash_mb) {
+    const int count = sizeof(bench_fens) / sizeof(bench_fens[0]);
+    std::vector<BenchEntry> entries(count);
+    std::vector<BenchThread> thread_results(threads);
+    std::atomic<int> next(0);
+
+    // 关闭评估扰动，固定种子
+    SearchLimits limits;
+    memset(&limits, 0, sizeof(limits));
+    limits.depth = depth;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.push_back(std::thread([&, t]() {
+            BenchThread& self = thread_results[t];
+            Engine engine;
+            engine.set_hash(hash_mb);
+            self.ok = true;
+            self.pages = engine.tt_page_type();
+            int i;
+            while ((i = next.fetch_add(1)) < count) {
+                Position pos;
+                if (!pos.set_fen(bench_fens[i])) {
+                    self.ok = false;
+                    continue;
+                }
+                engine.new_game();
+                SearchResult result = engine.search(pos, limits);
+                entries[i].nodes = engine.last_stats().nodes;
+                entries[i].allocations = engine.last_stats().allocations;
+                entries[i].score = result.score;
+                if (result.best_move != MOVE_NONE) {
+                    move_to_string(result.best_move, entries[i].best);
+                } else {
+                    snprintf(entries[i].best, sizeof(entries[i].best), "none");
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < pool.size(); t++) {
+        pool[t].join();
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    bool ok = true;
+    int pages = TT_PAGES_NORMAL;
+    for (int t = 0; t < threads; t++) {
+        ok = ok && thread_results[t].ok;
+        pages = thread_results[t].pages;
+    }
+
+    unsigned long long total = 0, allocations = 0;
+    for (int i = 0; i < count; i++) {
+        printf("Position %2d/%d  %-5s %6d  %llu nodes\n", i + 1, count, entries[i].best, entries[i].score, entries[i].nodes);
+        total += entries[i].nodes;
+        allocations += entries[i].allocations;
+    }
+    printf("===========================\n");
+    printf("Depth           : %d\n", depth);
+    // 每个线程是一个单线程引擎，各搜不同的局面，不是 Lazy SMP
+    printf("Threads         : %d (independent engines)\n", threads);
+    printf("Hash pages      : %s\n", pages == TT_PAGES_HUGE ? "huge" : pages == TT_PAGES_TRANSPARENT ? "transparent" : "normal");
+    printf("CPU kernels     : %s\n", cpu_variant_names[cpu_kernels.variant]);
+    printf("Total time (ms) : %.0f\n", ms);
+    printf("Nodes searched  : %llu\n", total);
+    printf("Nodes/second    : %.0f\n", ms > 0 ? total * 1000.0 / ms : 0.0);
+#ifdef CHESS_ALLOC_COUNT
+    // 搜索过程中不应有任何堆分配。上面的引擎都是单线程的，再用一个两线程的引擎（Lazy SMP）
+    // 把全部局面搜一遍，辅助线程的分配也计入
+    Engine smp;
+    smp.set_threads(2);
+    smp.set_hash(hash_mb);
+    unsigned long long smp_allocations = 0;
+    for (int i = 0; i < count; i++) {
+        Position pos;
+        if (pos.set_fen(bench_fens[i])) {
+            smp.new_game();
+            smp.search(pos, limits);
+            smp_allocations += smp.last_stats().allocations;
+        }
+    }
+    printf("Allocations     : %llu\n", allocations);
+    printf("Allocations SMP : %llu (2 threads)\n", smp_allocations);
+    if (allocations != 0 || smp_allocations != 0) {
+        ok = false;
+    }
+#endif
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include "cpu.h"
+#include <cstring>
+#if defined(__arm__)
+#include <sys/auxv.h>
+#endif
+
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+
+const char* const cpu_variant_names[CPU_VARIANT_COUNT] = {"generic", "popcnt", "bmi2", "avx2", "neon"};
+
+int movegen_kernels_generic(const Position& pos, Bitboard pieces, Bitboard allowed, MoveCode* list);
+Bitboard attackers_kernels_generic(const Position& pos, int sq, int attacker_side, Bitboard occ);
+int evaluate_kernels_generic(const Position& pos);
+void evaluate_batch_kernels_generic(const int8_t* squares, int stride, int count, int* scores);
+
+// 通用版本的函数地址是常量，静态初始化之前就可以安全调用
+CpuKernels cpu_kernels = {CPU_GENERIC, movegen_kernels_generic, attackers_kernels_generic, evaluate_kernels_generic,
+                          evaluate_batch_kernels_generic};
+
+PextSlider pext_bishop;
+PextSlider pext_rook;
+Bitboard pext_attacks[PEXT_TABLE_SIZE];
+
+bool cpu_supports(int variant) {
+    if (variant == CPU_GENERIC) {
+        return true;
+    }
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    bool popcnt = __builtin_cpu_supports("popcnt");
+    bool bmi2 = popcnt && __builtin_cpu_supports("bmi2");
+    switch (variant) {
+        case CPU_POPCNT: return popcnt;
+        case CPU_BMI2:   return bmi2;
+        case CPU_AVX2:   return bmi2 && __builtin_cpu_supports("avx2");
+    }
+#elif defined(__arm__) && CPU_HAVE_NEON
+    if (variant == CPU_NEON) {
+        return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+    }
+#endif
+    return false;
+}
+
+// Zen 2 及更早的 AMD 处理器上 pext 是微码实现，比普通射线算法还慢
+static bool slow_pext() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    return __builtin_cpu_is("amdfam15h") || __builtin_cpu_is("znver1") || __builtin_cpu_is("znver2");
+#else
+    return false;
+#endif
+}
+
+int cpu_detect() {
+    for (int v = CPU_VARIANT_COUNT - 1; v > CPU_GENERIC; v--) {
+        if ((v == CPU_BMI2 || v == CPU_AVX2) && slow_pext()) {
+            continue;
+        }
+        if (cpu_supports(v)) {
+            return v;
+        }
+    }
+    return CPU_GENERIC;
+}
+
+// 去掉每条射线最远的一格：边缘格有没有棋子都不影响攻击范围
+static Bitboard relevant_mask(int sq, int first_dir) {
+    Bitboard mask = 0;
+    for (int d = first_dir; d < first_dir + 4; d++) {
+        Bitboard ray = attack_tables.rays[d][sq];
+        if (ray) {
+            mask |= ray ^ BIT(d % 2 == 0 ? lsb(ray) : msb(ray));
+        }
+    }
+    return mask;
+}
+
+// 按从小到大的顺序枚举掩码的所有子集，第 i 个子集的 pext 结果恰好是 i
+static uint32_t fill_pext_slider(PextSlider& slider, int first_dir, uint32_t offset) {
+    for (int sq = 0; sq < 64; sq++) {
+        Bitboard mask = relevant_mask(sq, first_dir);
+        slider.mask[sq] = mask;
+        slider.offset[sq] = offset;
+        Bitboard subset = 0;
+        do {
+            pext_attacks[offset++] = first_dir == 0 ? bishop_attacks(sq, subset) : rook_attacks(sq, subset);
+            subset = (subset - mask) & mask;
+        } while (subset);
+    }
+    return offset;
+}
+
+static void init_pext_tables() {
+    static bool ready = false;
+    if (!ready) {
+        fill_pext_slider(pext_rook, 4, fill_pext_slider(pext_bishop, 0, 0));
+        ready = true;
+    }
+}
+
+bool cpu_select(int variant) {
+    if (variant < 0 || variant >= CPU_VARIANT_COUNT || !cpu_supports(variant)) {
+        return false;
+    }
+    if (variant == CPU_BMI2 || variant == CPU_AVX2) {
+        init_pext_tables();
+    }
+    cpu_kernels.variant = variant;
+    cpu_kernels.generate_moves = movegen_kernels[variant];
+    cpu_kernels.attackers_to = attackers_kernels[variant];
+    cpu_kernels.evaluate_pieces = evaluate_kernels[variant];
+    cpu_kernels.evaluate_batch = evaluate_batch_kernels[variant];
+    return true;
+}
+
+bool cpu_select(const char* name) {
+    if (strcmp(name, "auto") == 0) {
+        return cpu_select(cpu_detect());
+    }
+    for (int v = 0; v < CPU_VARIANT_COUNT; v++) {
+        if (strcmp(name, cpu_variant_names[v]) == 0) {
+            return cpu_select(v);
+        }
+    }
+    return false;
+}
+
+// 启动时自动选择，main 和各工具都不需要额外初始化
+static const bool cpu_auto_selected = cpu_select(cpu_detect());
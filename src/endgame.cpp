@@ -0,0 +1,225 @@
+#include "endgame.h"
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+// 生成过程中每个局面的结果，最后压缩成位
+#define KXK_UNKNOWN 0
+#define KXK_INVALID 1
+#define KXK_DRAW    2
+#define KXK_WIN     3
+
+#define LIGHT_SQUARES 0x55AA55AA55AA55AAULL   // (y + x) 为奇数的格子
+
+typedef struct {
+    uint8_t bits[KXK_POSITIONS / 8];
+} KxkBitbase;
+
+static KxkBitbase kqk_bitbase;
+static KxkBitbase krk_bitbase;
+static std::once_flag kqk_once;
+static std::once_flag krk_once;
+
+static Bitboard piece_attacks(int piece_type, int sq, Bitboard occ) {
+    Bitboard attacks = rook_attacks(sq, occ);
+    if (piece_type == QUEEN) {
+        attacks |= bishop_attacks(sq, occ);
+    }
+    return attacks;
+}
+
+// 后和车的走法左右、上下对称，把强方王翻到左上四分之一，其余棋子跟着翻
+static int kxk_index(bool strong_to_move, int wk, int bk, int piece) {
+    int flip = (SQ_X(wk) > 3 ? 7 : 0) | (SQ_Y(wk) > 3 ? 56 : 0);
+    wk ^= flip;
+    bk ^= flip;
+    piece ^= flip;
+    int wq = SQ_Y(wk) * 4 + SQ_X(wk);
+    return (((strong_to_move ? 0 : 1) * 16 + wq) * 64 + bk) * 64 + piece;
+}
+
+// 初始分类：非法局面、杀、逼和、弱方可以吃掉没有保护的子都能直接定出结果
+static uint8_t classify(int piece_type, bool strong_to_move, int wk, int bk, int piece) {
+    if (wk == bk || wk == piece || bk == piece || (king_attacks[wk] & BIT(bk))) {
+        return KXK_INVALID;
+    }
+    bool check = (piece_attacks(piece_type, piece, BIT(wk) | BIT(bk)) & BIT(bk)) != 0;
+    if (strong_to_move) {
+        return check ? KXK_INVALID : KXK_UNKNOWN;
+    }
+    // 弱方王离开后原来的格子不再挡住射线
+    Bitboard covered = king_attacks[wk] | piece_attacks(piece_type, piece, BIT(wk));
+    Bitboard targets = king_attacks[bk] & ~covered;
+    if (targets & BIT(piece)) {
+        return KXK_DRAW;
+    }
+    if (targets == 0) {
+        return check ? KXK_WIN : KXK_DRAW;
+    }
+    return KXK_UNKNOWN;
+}
+
+// 强方走棋：有一个后继必胜即必胜，全部和棋才是和棋；弱方走棋反过来
+static uint8_t retrograde_step(const uint8_t* result, int piece_type, bool strong_to_move, int wk, int bk, int piece) {
+    bool any_win = false, any_other = false;
+    if (strong_to_move) {
+        Bitboard king_moves = king_attacks[wk] & ~king_attacks[bk] & ~BIT(piece);
+        Bitboard piece_moves = piece_attacks(piece_type, piece, BIT(wk) | BIT(bk)) & ~BIT(wk);
+        while (king_moves) {
+            uint8_t r = result[kxk_index(false, pop_lsb(king_moves), bk, piece)];
+            any_win |= r == KXK_WIN;
+            any_other |= r != KXK_WIN;
+        }
+        while (piece_moves) {
+            uint8_t r = result[kxk_index(false, wk, bk, pop_lsb(piece_moves))];
+            any_win |= r == KXK_WIN;
+            any_other |= r != KXK_WIN;
+        }
+        if (any_win) return KXK_WIN;
+        return any_other ? KXK_UNKNOWN : KXK_DRAW;
+    }
+    Bitboard covered = king_attacks[wk] | piece_attacks(piece_type, piece, BIT(wk));
+    Bitboard targets = king_attacks[bk] & ~covered;
+    bool any_draw = false;
+    while (targets) {
+        uint8_t r = result[kxk_index(true, wk, pop_lsb(targets), piece)];
+        any_draw |= r == KXK_DRAW;
+        any_other |= r != KXK_WIN;
+    }
+    if (any_draw) return KXK_DRAW;
+    return any_other ? KXK_UNKNOWN : KXK_WIN;
+}
+
+// 逆向分析：反复扫描未定局面直到不再变化，剩下的都是和棋（弱方可以一直拖下去）
+static void generate_kxk(KxkBitbase& bitbase, int piece_type) {
+    uint8_t* result = (uint8_t*)calloc(KXK_POSITIONS, 1);
+    for (int stm = 0; stm < 2; stm++) {
+        for (int wq = 0; wq < 16; wq++) {
+            int wk = SQ(wq / 4, wq % 4);
+            for (int bk = 0; bk < 64; bk++) {
+                for (int piece = 0; piece < 64; piece++) {
+                    result[kxk_index(stm == 0, wk, bk, piece)] = classify(piece_type, stm == 0, wk, bk, piece);
+                }
+            }
+        }
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < KXK_POSITIONS; i++) {
+            if (result[i] != KXK_UNKNOWN) {
+                continue;
+            }
+            int piece = i & 63, bk = (i >> 6) & 63, wq = (i >> 12) & 15;
+            bool strong_to_move = (i >> 16) == 0;
+            uint8_t r = retrograde_step(result, piece_type, strong_to_move, SQ(wq / 4, wq % 4), bk, piece);
+            if (r != KXK_UNKNOWN) {
+                result[i] = r;
+                changed = true;
+            }
+        }
+    }
+    memset(bitbase.bits, 0, sizeof(bitbase.bits));
+    for (int i = 0; i < KXK_POSITIONS; i++) {
+        if (result[i] == KXK_WIN) {
+            bitbase.bits[i >> 3] |= (uint8_t)(1 << (i & 7));
+        }
+    }
+    free(result);
+}
+
+bool probe_kxk(int piece_type, int strong_king, int strong_piece, int weak_king, bool strong_to_move) {
+    KxkBitbase* bitbase = &krk_bitbase;
+    if (piece_type == QUEEN) {
+        std::call_once(kqk_once, generate_kxk, std::ref(kqk_bitbase), QUEEN);
+        bitbase = &kqk_bitbase;
+    } else {
+        std::call_once(krk_once, generate_kxk, std::ref(krk_bitbase), ROOK);
+    }
+    int i = kxk_index(strong_to_move, strong_king, weak_king, strong_piece);
+    return (bitbase->bits[i >> 3] >> (i & 7)) & 1;
+}
+
+static int distance(int a, int b) {
+    int dy = abs(SQ_Y(a) - SQ_Y(b)), dx = abs(SQ_X(a) - SQ_X(b));
+    return dy > dx ? dy : dx;
+}
+
+// 离中心越远分越高，角上最高
+static int push_to_edge(int sq) {
+    int y = SQ_Y(sq), x = SQ_X(sq);
+    int dy = y < 4 ? 3 - y : y - 4;
+    int dx = x < 4 ? 3 - x : x - 4;
+    return (dy + dx) * 20;
+}
+
+// 两王越近分越高
+static int push_close(int a, int b) {
+    return (7 - distance(a, b)) * 20;
+}
+
+static int strong_material(const Position& pos, int strong) {
+    int score = 0;
+    for (int type = PAWN; type <= QUEEN; type++) {
+        score += popcount(pos.pieces(strong, type)) * get_piece_value(type) * 10;
+    }
+    return score;
+}
+
+// 对单王：把弱方王赶到边上并让强方王靠近；王加后或车时先查位库排除逼和与丢子
+static int evaluate_kxk(const Position& pos, int strong) {
+    int wk = pos.king_sq[color_index(strong)];
+    int bk = pos.king_sq[color_index(-strong)];
+    if (popcount(pos.occupied()) == 3) {
+        int type = pos.pieces(strong, QUEEN) ? QUEEN : ROOK;
+        int piece = lsb(pos.pieces(strong, type));
+        if (!probe_kxk(type, wk, piece, bk, pos.side == strong)) {
+            return 0;
+        }
+    }
+    return SCORE_KNOWN_WIN + strong_material(pos, strong) + push_to_edge(bk) + push_close(wk, bk);
+}
+
+// 王象马对单王：只能在象所在颜色的角上将杀，按到这两个角的距离赶
+static int evaluate_kbnk(const Position& pos, int strong) {
+    int wk = pos.king_sq[color_index(strong)];
+    int bk = pos.king_sq[color_index(-strong)];
+    bool light = (pos.pieces(strong, BISHOP) & LIGHT_SQUARES) != 0;
+    int corner_a = light ? SQ(0, 7) : SQ(0, 0);
+    int corner_b = light ? SQ(7, 0) : SQ(7, 7);
+    int d = distance(bk, corner_a) < distance(bk, corner_b) ? distance(bk, corner_a) : distance(bk, corner_b);
+    return SCORE_KNOWN_WIN + strong_material(pos, strong) + (7 - d) * 40 + push_close(wk, bk);
+}
+
+bool evaluate_endgame(const Position& pos, int& score) {
+    int strong;
+    if (popcount(pos.by_color[1]) == 1) {
+        strong = 1;
+    } else if (popcount(pos.by_color[0]) == 1) {
+        strong = -1;
+    } else {
+        return false;
+    }
+    int pawns = popcount(pos.pieces(strong, PAWN));
+    int knights = popcount(pos.pieces(strong, KNIGHT));
+    Bitboard bishops = pos.pieces(strong, BISHOP);
+    bool majors = (pos.pieces(strong, ROOK) | pos.pieces(strong, QUEEN)) != 0;
+    bool both_colors = (bishops & LIGHT_SQUARES) && (bishops & ~LIGHT_SQUARES);
+
+    int value;
+    if (majors || both_colors || (bishops && knights > 1)) {
+        value = evaluate_kxk(pos, strong);
+    } else if (bishops && knights == 1 && popcount(bishops) == 1) {
+        value = evaluate_kbnk(pos, strong);
+    } else if (pawns == 0 && knights <= 2 && !(bishops && knights)) {
+        // 双王、王单马、王马马、同色象：无法强制将杀
+        value = 0;
+    } else if (pawns == 1 && knights == 0 && !bishops) {
+        // 王兵对王：本项目没有升变，兵走到底线后不能再动，单兵也不可能将杀
+        value = 0;
+    } else {
+        return false;
+    }
+    score = value * strong * pos.side;
+    return true;
+}
@@ -0,0 +1,227 @@
+#include "evaluate.h"
+#include "endgame.h"
+#include "piece.h"
+#include "piece_square.h"
+#include <cstdlib>
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#if CPU_HAVE_NEON
+// GCC 的 arm_neon.h 自带 fpu=neon 的 target pragma，但软浮点 ABI 下会直接报错
+#include <arm_neon.h>
+#endif
+
+// 子力与位置分合并成一张表，[piece + 6][sq]：白方为正、黑方为负，王只计位置分，空格为 0。
+// 批量评估的查表：每格 16 项，下标为棋子编码 + KING（13 到 15 为 0），16 位的值拆成低、高两个字节。
+// 单项绝对值不超过 4096，8 格之和在 16 位内不会溢出
+struct PieceSquareValues {
+    int values[13][64];
+    alignas(16) uint8_t lo[64][16];
+    alignas(16) uint8_t hi[64][16];
+};
+
+constexpr PieceSquareValues make_piece_square_values() {
+    PieceSquareValues t = {};
+    for (int piece = -KING; piece <= KING; piece++) {
+        for (int sq = 0; sq < 64; sq++) {
+            int value = 0;
+            if (piece != EMPTY) {
+                int sign = piece > 0 ? 1 : -1;
+                int material = piece == KING || piece == -KING ? 0 : get_piece_value(piece) * 10;
+                value = sign * (material + piece_square_table.score[piece_index(piece)][sq]);
+            }
+            t.values[piece + KING][sq] = value;
+            t.lo[sq][piece + KING] = (uint8_t)(value & 0xFF);
+            t.hi[sq][piece + KING] = (uint8_t)((value >> 8) & 0xFF);
+        }
+    }
+    return t;
+}
+
+alignas(16) static constexpr PieceSquareValues piece_square_tables = make_piece_square_values();
+
+static constexpr const int (&piece_square_values)[13][64] = piece_square_tables.values;
+static constexpr const uint8_t (&batch_values_lo)[64][16] = piece_square_tables.lo;
+static constexpr const uint8_t (&batch_values_hi)[64][16] = piece_square_tables.hi;
+
+#if defined(__x86_64__)
+// 按格扫描整个棋盘：每次读 8 格的棋子编码，用 gather 取出对应表项累加，没有分支
+CPU_TARGET_AVX2 static int evaluate_pieces_avx2(const Position& pos) {
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i offset = _mm256_set1_epi32(KING * 64);
+    __m256i sum = _mm256_setzero_si256();
+    for (int sq = 0; sq < 64; sq += 8) {
+        __m256i piece = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(pos.squares + sq)));
+        __m256i index = _mm256_add_epi32(_mm256_add_epi32(_mm256_slli_epi32(piece, 6), offset),
+                                         _mm256_add_epi32(lanes, _mm256_set1_epi32(sq)));
+        sum = _mm256_add_epi32(sum, _mm256_i32gather_epi32(&piece_square_values[0][0], index, 4));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+#endif
+
+// 子力与位置分，白方视角
+template <int Isa>
+static CPU_KERNEL_INLINE int evaluate_pieces_for(const Position& pos) {
+#if defined(__x86_64__)
+    if constexpr (Isa == CPU_AVX2) {
+        return evaluate_pieces_avx2(pos);
+    }
+#endif
+    int score = 0;
+    Bitboard occ = pos.occupied();
+    while (occ) {
+        int sq = pop_lsb(occ);
+        score += piece_square_values[pos.squares[sq] + KING][sq];
+    }
+    return score;
+}
+
+CPU_DISPATCH_TABLE(evaluate_kernels, evaluate_pieces_for, int, (const Position& pos), (pos));
+
+#if defined(__x86_64__)
+// 每次 32 个局面：逐格读入 32 个棋子编码，pshufb 按编码查出值的低、高字节，交织成 16 位累加，
+// 每 8 格扩展到 32 位一次。返回处理完的局面数，剩下不足 32 个的由调用方处理
+CPU_TARGET_AVX2 static int evaluate_batch_avx2(const int8_t* squares, int stride, int count, int* scores) {
+    const __m256i bias = _mm256_set1_epi8(KING);
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i sum0 = _mm256_setzero_si256(), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+        for (int sq = 0; sq < 64; sq += 8) {
+            // unpacklo 得到第 0-7、16-23 个局面，unpackhi 得到第 8-15、24-31 个
+            __m256i low = _mm256_setzero_si256(), high = low;
+            for (int k = sq; k < sq + 8; k++) {
+                __m256i index = _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(squares + k * stride + i)), bias);
+                __m256i lo = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)batch_values_lo[k])), index);
+                __m256i hi = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)batch_values_hi[k])), index);
+                low = _mm256_add_epi16(low, _mm256_unpacklo_epi8(lo, hi));
+                high = _mm256_add_epi16(high, _mm256_unpackhi_epi8(lo, hi));
+            }
+            sum0 = _mm256_add_epi32(sum0, _mm256_cvtepi16_epi32(_mm256_castsi256_si128(low)));
+            sum1 = _mm256_add_epi32(sum1, _mm256_cvtepi16_epi32(_mm256_castsi256_si128(high)));
+            sum2 = _mm256_add_epi32(sum2, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(low, 1)));
+            sum3 = _mm256_add_epi32(sum3, _mm256_cvtepi16_epi32(_mm256_extracti128_si256(high, 1)));
+        }
+        _mm256_storeu_si256((__m256i*)(scores + i), sum0);
+        _mm256_storeu_si256((__m256i*)(scores + i + 8), sum1);
+        _mm256_storeu_si256((__m256i*)(scores + i + 16), sum2);
+        _mm256_storeu_si256((__m256i*)(scores + i + 24), sum3);
+    }
+    return i;
+}
+#endif
+
+#if CPU_HAVE_NEON
+// 每次 8 个局面：vtbl2 按编码查出低、高字节，交织成 16 位后直接扩展累加到 32 位
+CPU_TARGET_NEON static int evaluate_batch_neon(const int8_t* squares, int stride, int count, int* scores) {
+    const uint8x8_t bias = vdup_n_u8(KING);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int32x4_t sum0 = vdupq_n_s32(0), sum1 = sum0;
+        for (int sq = 0; sq < 64; sq++) {
+            uint8x8_t index = vadd_u8(vld1_u8((const uint8_t*)(squares + sq * stride + i)), bias);
+            uint8x8x2_t table_lo = {{vld1_u8(batch_values_lo[sq]), vld1_u8(batch_values_lo[sq] + 8)}};
+            uint8x8x2_t table_hi = {{vld1_u8(batch_values_hi[sq]), vld1_u8(batch_values_hi[sq] + 8)}};
+            uint8x8x2_t value = vzip_u8(vtbl2_u8(table_lo, index), vtbl2_u8(table_hi, index));
+            int16x8_t v = vreinterpretq_s16_u8(vcombine_u8(value.val[0], value.val[1]));
+            sum0 = vaddw_s16(sum0, vget_low_s16(v));
+            sum1 = vaddw_s16(sum1, vget_high_s16(v));
+        }
+        vst1q_s32(scores + i, sum0);
+        vst1q_s32(scores + i + 4, sum1);
+    }
+    return i;
+}
+
+#if defined(__ARM_NEON)
+static constexpr bool neon_by_default = true;
+#else
+static constexpr bool neon_by_default = false;
+#endif
+#endif
+
+// 批量子力与位置分：向量版本处理整组局面，剩余的局面逐格查表
+template <int Isa>
+static CPU_KERNEL_INLINE void evaluate_batch_for(const int8_t* squares, int stride, int count, int* scores) {
+    int i = 0;
+#if defined(__x86_64__)
+    if constexpr (Isa == CPU_AVX2) {
+        i = evaluate_batch_avx2(squares, stride, count, scores);
+    }
+#endif
+#if CPU_HAVE_NEON
+    // neon 版本总是用向量内核；编译器默认就带 NEON 时（aarch64 或 -mfpu=neon）通用版本也可以用
+    if constexpr (Isa == CPU_NEON || (Isa == CPU_GENERIC && neon_by_default)) {
+        i = evaluate_batch_neon(squares, stride, count, scores);
+    }
+#endif
+    // 按格在外层循环，各局面的棋子编码和分数都是顺序访问
+    for (int j = i; j < count; j++) {
+        scores[j] = 0;
+    }
+    for (int sq = 0; sq < 64; sq++) {
+        const int8_t* row = squares + sq * stride;
+        for (int j = i; j < count; j++) {
+            scores[j] += piece_square_values[row[j] + KING][sq];
+        }
+    }
+}
+
+CPU_DISPATCH_TABLE(evaluate_batch_kernels, evaluate_batch_for, void,
+                   (const int8_t* squares, int stride, int count, int* scores), (squares, stride, count, scores));
+
+EvalBatch::EvalBatch(int capacity) : count(0) {
+    limit = capacity > 0 ? capacity : 1;
+    stride = (limit + EVAL_BATCH_ALIGN - 1) / EVAL_BATCH_ALIGN * EVAL_BATCH_ALIGN;
+    squares.assign((size_t)stride * 64, EMPTY);
+}
+
+bool EvalBatch::add(const Position& pos) {
+    if (count >= limit) {
+        return false;
+    }
+    for (int sq = 0; sq < 64; sq++) {
+        squares[(size_t)sq * stride + count] = pos.squares[sq];
+    }
+    count++;
+    return true;
+}
+
+void EvalBatch::evaluate(int* scores) const {
+    cpu_kernels.evaluate_batch(squares.data(), stride, count, scores);
+}
+
+static int evaluate_pieces(const Position& pos) {
+    return cpu_kernels.evaluate_pieces(pos);
+}
+
+int evaluate(const Position& pos) {
+    int score;
+    if (evaluate_endgame(pos, score)) {
+        return score;
+    }
+    return (evaluate_pieces(pos) + evaluate_pawns(pos)) * pos.side;
+}
+
+Evaluator::Evaluator() {
+    memset(cache, 0, sizeof(cache));
+}
+
+// 与 evaluate(pos) 结果相同，只是兵形分和整个评估都先查缓存
+int Evaluator::evaluate(const Position& pos) {
+    EvalCacheEntry& e = cache[pos.key & (EVAL_CACHE_SIZE - 1)];
+    if (e.key == pos.key) {
+        return e.score;
+    }
+    int score;
+    if (!evaluate_endgame(pos, score)) {
+        score = (evaluate_pieces(pos) + pawns.probe(pos)) * pos.side;
+    }
+    e.key = pos.key;
+    e.score = score;
+    return score;
+}
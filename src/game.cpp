@@ -2,6 +2,11 @@
 #include "piece.h"
 #include <ncurses.h>
 #include "ai_player.h"
+#include "zobrist.h"
+#include "session.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #define BOARD_SIZE 8
 #define CELL_WIDTH 4
@@ -12,152 +17,209 @@
 // 总高度：棋盘(8*3) + 底部坐标轴空间(2)
 #define TOTAL_H (BOARD_SIZE * CELL_HEIGHT)
 
+#define DASHBOARD_WIDTH 28
+#define DASHBOARD_LINES (21 + HINT_LINES + 1)   // 仪表盘最多占用的行数
+#define LATENCY_WIDTH 34                        // 延迟叠加层的宽度，高度为 STAGE_COUNT + 1 行
+
 void Game::draw_ui(int start_y, int start_x, int cur_y, int cur_x) {
-    // 绘制坐标轴
-    for (int i = 0; i < BOARD_SIZE; i++) {
-        mvprintw(start_y + i * CELL_HEIGHT + CELL_HEIGHT/2, start_x - 2, "%d", 8 - i);
-    }
-    // 绘制字母坐标轴
-    for (int j = 0; j < BOARD_SIZE; j++) {
-        mvprintw(start_y + BOARD_SIZE * CELL_HEIGHT, start_x + j * CELL_WIDTH + CELL_WIDTH/2, "%c", 'A' + j);
+    // 坐标轴只在整帧重绘时绘制
+    if (!frame_valid) {
+        for (int i = 0; i < BOARD_SIZE; i++) {
+            mvprintw(start_y + i * CELL_HEIGHT + CELL_HEIGHT/2, start_x - 2, "%d", 8 - i);
+        }
+        for (int j = 0; j < BOARD_SIZE; j++) {
+            mvprintw(start_y + BOARD_SIZE * CELL_HEIGHT, start_x + j * CELL_WIDTH + CELL_WIDTH/2, "%c", 'A' + j);
+        }
     }
 
     for (int i = 0; i < BOARD_SIZE; i++) {
         for (int j = 0; j < BOARD_SIZE; j++) {
-            int py = start_y + (i * CELL_HEIGHT);
-            int px = start_x + (j * CELL_WIDTH);
-
-            int background_color = 0;
-            // 颜色逻辑
-            if ( (i + j) % 2) {
-                attron(COLOR_PAIR(1));
-                background_color = COLOR_WHITE;
-            } else  {
-                attron(COLOR_PAIR(2));
-                background_color = COLOR_BLACK;
+            // 背景颜色对：1 浅色格，2 深色格，3 光标，4 预测移动，5 被吃/被将军
+            int background = (i + j) % 2 ? 1 : 2;
+            bool predicted = (predicted_moves & BIT(SQ(i, j))) != 0;
+            if (hint_moves & BIT(SQ(i, j))) {
+                background = 4;
+            }
+            if (predicted) {
+                background = 4;
             }
-
-            if (predicted_moves[i][j] != 0) {
-                attron(COLOR_PAIR(4));
-                background_color = COLOR_CYAN;
-            };
-            // 高亮逻辑（光标选中）
             if (i == cur_y && j == cur_x) {
-                attron(COLOR_PAIR(3));
-                background_color = COLOR_YELLOW;
-            };
-            if (board[i][j] != EMPTY && board[i][j] * selected_piece < 0 && predicted_moves[i][j] != 0) {
-                attron(COLOR_PAIR(5));
-                background_color = COLOR_RED;
-            };
-            if (board[i][j] == KING && white_in_check) {
-                attron(COLOR_PAIR(5));
-                background_color = COLOR_RED;
+                background = 3;
             }
-            if (board[i][j] == -KING && black_in_check) {
-                attron(COLOR_PAIR(5));
-                background_color = COLOR_RED;
+            if (board[i][j] != EMPTY && board[i][j] * selected_piece < 0 && predicted) {
+                background = 5;
+            }
+            if ((board[i][j] == KING && white_in_check) || (board[i][j] == -KING && black_in_check)) {
+                background = 5;
             }
 
-            // 填充格子
+            // 与上一帧相同的格子不再重绘
+            int piece = board[i][j];
+            int state = background * 16 + piece + KING;
+            if (frame_valid && frame_cells[i][j] == state) {
+                continue;
+            }
+            frame_cells[i][j] = state;
+
+            int py = start_y + (i * CELL_HEIGHT);
+            int px = start_x + (j * CELL_WIDTH);
+            attrset(COLOR_PAIR(background));
             for (int h = 0; h < CELL_HEIGHT; h++) {
                 mvhline(py + h, px, ' ', CELL_WIDTH);
             }
 
-            // 绘制棋子
-            int piece = board[i][j];
+            // 棋子颜色对：白方 11..15，黑方 21..25，个位与背景颜色对一致
             if (piece != EMPTY) {
-                if (piece > 0) {
-                    switch (background_color) {
-                        case COLOR_WHITE:
-                            attron(COLOR_PAIR(11));
-                            break;
-                        case COLOR_BLACK:
-                            attron(COLOR_PAIR(12));
-                            break;
-                        case COLOR_YELLOW:
-                            attron(COLOR_PAIR(13));
-                            break;
-                        case COLOR_CYAN:
-                            attron(COLOR_PAIR(14));
-                            break;
-                        case COLOR_RED:
-                            attron(COLOR_PAIR(15));
-                            break;
-                    }
-                } else {
-                    switch (background_color) {
-                        case COLOR_WHITE:
-                            attron(COLOR_PAIR(21));
-                            break;
-                        case COLOR_BLACK:
-                            attron(COLOR_PAIR(22));
-                            break;
-                        case COLOR_YELLOW:
-                            attron(COLOR_PAIR(23));
-                            break;
-                        case COLOR_CYAN:
-                            attron(COLOR_PAIR(24));
-                            break;
-                        case COLOR_RED:
-                            attron(COLOR_PAIR(25));
-                            break;
-                    }
-                }
-                // 居中打印字母
+                attrset(COLOR_PAIR((piece > 0 ? 10 : 20) + background));
                 mvprintw(py + CELL_HEIGHT / 2, px + (CELL_WIDTH - 2) / 2, "%s", get_piece_letter(piece));
-                
-                attroff(COLOR_PAIR(11)); attroff(COLOR_PAIR(12)); attroff(COLOR_PAIR(13)); attroff(COLOR_PAIR(14)); attroff(COLOR_PAIR(15));
-                attroff(COLOR_PAIR(21)); attroff(COLOR_PAIR(22)); attroff(COLOR_PAIR(23)); attroff(COLOR_PAIR(24)); attroff(COLOR_PAIR(25));
             }
+        }
+    }
+    attrset(A_NORMAL);
+}
+
+// 只把变化的部分写入终端：棋盘按格子比较，仪表盘在回合变化时重绘
+void Game::render(int start_y, int start_x, int cur_y, int cur_x) {
+    int dash_y = start_y;
+    int dash_x = start_x + 32 + 2;
+
+    if (!frame_valid) {
+        erase();
+    }
+    uint64_t start = latency_now_us();
+    draw_ui(start_y, start_x, cur_y, cur_x);
+    latency.record_since(STAGE_DRAW_UI, start);
+
+    start = latency_now_us();
+    if (!frame_valid || dashboard_round != current_round) {
+        draw_dashboard(dash_y, dash_x, current_round % 2 == 1 ? 1 : -1, current_round);
+        dashboard_round = current_round;
+    }
+    // 棋钟每帧都在走，单独重绘这一行
+    draw_clocks(dash_y + 2, dash_x);
+    latency.record_since(STAGE_DASHBOARD, start);
 
-            // 关闭颜色属性
-            attroff(COLOR_PAIR(1)); attroff(COLOR_PAIR(2)); attroff(COLOR_PAIR(3)); attroff(COLOR_PAIR(4)); attroff(COLOR_PAIR(5));
+    // 终端够宽时放在仪表盘右侧，否则放在棋盘下方，行数不够时截掉后面的阶段
+    if (latency_overlay) {
+        int max_y, max_x;
+        getmaxyx(stdscr, max_y, max_x);
+        int side_x = dash_x + DASHBOARD_WIDTH + 2;
+        if (side_x + LATENCY_WIDTH <= max_x) {
+            draw_latency(start_y, side_x, max_y - start_y);
+        } else {
+            draw_latency(start_y + TOTAL_H + 2, start_x - 2, max_y - (start_y + TOTAL_H + 2));
         }
     }
+    frame_valid = true;
+
+    start = latency_now_us();
+    wnoutrefresh(stdscr);
+    doupdate();
+    latency.record_since(STAGE_OUTPUT, start);
+    // 这一帧已经包含上一次按键的结果
+    if (input_us) {
+        latency.record_since(STAGE_FRAME, input_us);
+        input_us = 0;
+    }
+}
+
+// 计时的 getch：记录等待时间，读到按键时把返回时刻作为这次输入的起点
+int Game::timed_getch() {
+    uint64_t start = latency_now_us();
+    int ch = session_getch();
+    uint64_t end = latency_now_us();
+    latency.record(STAGE_GETCH, end - start);
+    if (ch != ERR) {
+        input_us = end;
+    }
+    return ch;
+}
+
+// 延迟叠加层：各阶段的 p50 / p99 / 最大值，单位毫秒
+void Game::draw_latency(int start_y, int start_x, int max_rows) {
+    if (max_rows <= 1) {
+        return;
+    }
+    attrset(COLOR_PAIR(31));
+    mvprintw(start_y, start_x, " %-10s %6s %6s %7s ", "latency ms", "p50", "p99", "max");
+    for (int s = 0; s < STAGE_COUNT && s + 1 < max_rows; s++) {
+        const LatencyHistogram& h = latency.stage(s);
+        mvprintw(start_y + 1 + s, start_x, " %-10s %6.2f %6.2f %7.1f ", latency_stage_names[s],
+                 h.percentile(50) / 1000.0, h.percentile(99) / 1000.0, h.max() / 1000.0);
+    }
+    attrset(A_NORMAL);
 }
 
 void Game::double_mode_start() {
     int cur_y = 0, cur_x = 0;
     int max_y, max_x;
 
+    // 启用棋钟时 getch 定时返回，以便刷新剩余时间
+    timeout(clock_enabled ? 100 : -1);
     while (1) {
+        // 上一次按键的处理到这里结束
+        if (input_us) {
+            latency.record_since(STAGE_HANDLER, input_us);
+        }
         getmaxyx(stdscr, max_y, max_x);
-        clear();
+        uint64_t rules_start = latency_now_us();
+        update_legal_moves();
+        update_clocks();
+        latency.record_since(STAGE_RULES, rules_start);
 
         int start_y = 2;
         int start_x = 4; // +2 是为了给左侧坐标轴留位置
 
-        int dash_y = start_y;
-        int dash_x = start_x + 32 + 2; 
-
-        draw_ui(start_y, start_x, cur_y, cur_x);
-        draw_dashboard(dash_y, dash_x, current_round % 2 == 1 ? 1 : -1, current_round);
-        refresh();
+        render(start_y, start_x, cur_y, cur_x);
 
         // 检查是否游戏结束
         if (white_in_checkmate) {
             mvprintw(max_y / 2, (max_x - 18) / 2, "Checkmate! Black wins! Press q or Q to exit.");
             refresh();
-            getch();
+            session_getch();
             break;
         }
 
         if (black_in_checkmate) {
             mvprintw(max_y / 2, (max_x - 18) / 2, "Checkmate! White wins! Press q or Q to exit.");
             refresh();
-            getch();
+            session_getch();
+            break;
+        }
+
+        if (stalemate) {
+            mvprintw(max_y / 2, (max_x - 18) / 2, "Stalemate! Draw! Press q or Q to exit.");
+            refresh();
+            session_getch();
+            break;
+        }
+
+        if (time_forfeit != 0) {
+            mvprintw(max_y / 2, (max_x - 18) / 2, time_forfeit == 1 ? "Time! Black wins! Press q or Q to exit."
+                                                                  : "Time! White wins! Press q or Q to exit.");
+            refresh();
             break;
         }
 
-        int ch = getch();
+        int ch = timed_getch();
         if (ch == 'q' || ch == 'Q') {
+            timeout(-1);
             return;
         };
+        if (ch == 'h' || ch == 'H') {
+            show_hint();
+        }
+        if (ch == 'l' || ch == 'L') {
+            latency_overlay = !latency_overlay;
+            frame_valid = false;
+        }
+        if (ch == KEY_RESIZE) {
+            frame_valid = false;
+        }
         // 处理鼠标点击
         if (ch == KEY_MOUSE) {
             MEVENT event;
-            if (getmouse(&event) == OK) {
+            if (session_getmouse(&event) == OK) {
                 if (event.bstate & (BUTTON1_CLICKED | BUTTON1_PRESSED)) {
                     // 坐标转换逻辑
                     int mouse_grid_y = (event.y - start_y) / CELL_HEIGHT;
@@ -175,21 +237,11 @@ void Game::double_mode_start() {
                         selected_x = cur_x;
                         selected_y = cur_y;
                         if (selected_piece != EMPTY && selected_piece * (current_round % 2 == 1 ? 1 : -1) > 0) {
-                            predicted_moves = {
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            };
-                            predict_move(cur_y, cur_x, predicted_moves);
+                            predicted_moves = legal_targets[SQ(cur_y, cur_x)];
                         }
                     } else {
                         int target_piece = board[cur_y][cur_x];
-                        if (predicted_moves[cur_y][cur_x] != 0 && (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0 || target_piece == 0)) {
+                        if ((predicted_moves & BIT(SQ(cur_y, cur_x))) && (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0 || target_piece == 0)) {
                             // 捕获棋子
                             if (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0) {
                                 if (current_round % 2 == 1) {
@@ -207,53 +259,15 @@ void Game::double_mode_start() {
                             selected_y = 0;
                             current_round++;
 
-                            predicted_moves = {
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                            };
-
-                            // 检查是否将军
-                            if (is_in_check(1)) {
-                                if (is_checkmate(1)) {
-                                    white_in_checkmate = true;
-                                } else {
-                                    white_in_check = true;
-                                }
-                            } else {
-                                white_in_check = false;
-                            }
+                            predicted_moves = 0;
 
-                            if (is_in_check(-1)) {
-                                if (is_checkmate(-1)) {
-                                    black_in_checkmate = true;
-                                } else {
-                                    black_in_check = true;
-                                }
-                            } else {
-                                black_in_check = false;
-                            }
                         } else {
                             selected_piece = board[cur_y][cur_x];
                             selected_x = cur_x;
                             selected_y = cur_y;
-                            predicted_moves = {
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            };
+                            predicted_moves = 0;
                             if (selected_piece != EMPTY && selected_piece * (current_round % 2 == 1 ? 1 : -1) > 0) {
-                                predict_move(cur_y, cur_x, predicted_moves);
+                                predicted_moves = legal_targets[SQ(cur_y, cur_x)];
                             }
                         }
                     }
@@ -282,23 +296,13 @@ void Game::double_mode_start() {
                 selected_x = cur_x;
                 selected_y = cur_y;
                 if (selected_piece != EMPTY && selected_piece * (current_round % 2 == 1 ? 1 : -1) > 0) {
-                    predicted_moves = {
-                    {0, 0, 0, 0, 0, 0, 0, 0},
-                    {0, 0, 0, 0, 0, 0, 0, 0},
-                    {0, 0, 0, 0, 0, 0, 0, 0},
-                    {0, 0, 0, 0, 0, 0, 0, 0},
-                    {0, 0, 0, 0, 0, 0, 0, 0},
-                    {0, 0, 0, 0, 0, 0, 0, 0},
-                    {0, 0, 0, 0, 0, 0, 0, 0},
-                    {0, 0, 0, 0, 0, 0, 0, 0},
-                    };
-                    predict_move(cur_y, cur_x, predicted_moves);
+                    predicted_moves = legal_targets[SQ(cur_y, cur_x)];
                 }
             }
             if (ch == '\n') { //处理键盘确认键
                 if (choose) {
                     int target_piece = board[cur_y][cur_x];
-                    if (predicted_moves[cur_y][cur_x] != 0 && (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0 || target_piece == 0)) {
+                    if ((predicted_moves & BIT(SQ(cur_y, cur_x))) && (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0 || target_piece == 0)) {
                         // 捕获棋子
                         if (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0) {
                             if (current_round % 2 == 1) {
@@ -317,53 +321,15 @@ void Game::double_mode_start() {
                         choose = false;
                         current_round++;
 
-                        predicted_moves = {
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                        };
-
-                        // 检查是否将军
-                        if (is_in_check(1)) {
-                            if (is_checkmate(1)) {
-                                white_in_checkmate = true;
-                            } else {
-                                white_in_check = true;
-                            }
-                        } else {
-                            white_in_check = false;
-                        }
+                        predicted_moves = 0;
 
-                        if (is_in_check(-1)) {
-                            if (is_checkmate(-1)) {
-                                black_in_checkmate = true;
-                            } else {
-                                black_in_check = true;
-                            }
-                        } else {
-                            black_in_check = false;
-                        }
                     } else {
                         selected_piece = board[cur_y][cur_x];
                         selected_x = cur_x;
                         selected_y = cur_y;
-                        predicted_moves = {
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        };
+                        predicted_moves = 0;
                         if (selected_piece != EMPTY && selected_piece * (current_round % 2 == 1 ? 1 : -1) > 0) {
-                            predict_move(cur_y, cur_x, predicted_moves);
+                            predicted_moves = legal_targets[SQ(cur_y, cur_x)];
                         }
                     }
                 } else {
@@ -377,8 +343,9 @@ void Game::double_mode_start() {
     }
 
     // 按q或Q退出游戏
+    timeout(-1);
     while (true) {
-        int ch = getch();
+        int ch = session_getch();
         if (ch == 'q' || ch == 'Q') break;
     }
 }
@@ -388,45 +355,77 @@ void Game::single_mode_start() {
     int max_y, max_x;
 
     AIPlayer ai_player;
+    ai_player.set_book(&book);
+    ai_player.set_difficulty(difficulty);
+    search_stats = NULL;
 
+    // 启用棋钟时 getch 定时返回，以便刷新剩余时间
+    timeout(clock_enabled ? 100 : -1);
     while (1) {
+        // 上一次按键的处理到这里结束
+        if (input_us) {
+            latency.record_since(STAGE_HANDLER, input_us);
+        }
         getmaxyx(stdscr, max_y, max_x);
-        clear();
+        uint64_t rules_start = latency_now_us();
+        update_legal_moves();
+        update_clocks();
+        latency.record_since(STAGE_RULES, rules_start);
 
         int start_y = 2;
         int start_x = 4; // +2 是为了给左侧坐标轴留位置
 
-        int dash_y = start_y;
-        int dash_x = start_x + 32 + 2; 
-
-        draw_ui(start_y, start_x, cur_y, cur_x);
-        draw_dashboard(dash_y, dash_x, current_round % 2 == 1 ? 1 : -1, current_round);
-        refresh();
+        render(start_y, start_x, cur_y, cur_x);
 
         // 检查是否游戏结束
         if (white_in_checkmate) {
             mvprintw(max_y / 2, (max_x - 18) / 2, "Checkmate! Black wins! Press q or Q to exit.");
             refresh();
-            getch();
+            session_getch();
             break;
         }
 
         if (black_in_checkmate) {
             mvprintw(max_y / 2, (max_x - 18) / 2, "Checkmate! White wins! Press q or Q to exit.");
             refresh();
-            getch();
+            session_getch();
+            break;
+        }
+
+        if (stalemate) {
+            mvprintw(max_y / 2, (max_x - 18) / 2, "Stalemate! Draw! Press q or Q to exit.");
+            refresh();
+            session_getch();
+            break;
+        }
+
+        if (time_forfeit != 0) {
+            mvprintw(max_y / 2, (max_x - 18) / 2, time_forfeit == 1 ? "Time! Black wins! Press q or Q to exit."
+                                                                  : "Time! White wins! Press q or Q to exit.");
+            refresh();
             break;
         }
 
         if (current_round % 2 == 1) {
-            int ch = getch();
+            int ch = timed_getch();
             if (ch == 'q' || ch == 'Q') {
+                timeout(-1);
                 return;
             };
+            if (ch == 'h' || ch == 'H') {
+                show_hint();
+            }
+            if (ch == 'l' || ch == 'L') {
+                latency_overlay = !latency_overlay;
+                frame_valid = false;
+            }
+            if (ch == KEY_RESIZE) {
+                frame_valid = false;
+            }
             // 处理鼠标点击
             if (ch == KEY_MOUSE) {
                 MEVENT event;
-                if (getmouse(&event) == OK) {
+                if (session_getmouse(&event) == OK) {
                     if (event.bstate & (BUTTON1_CLICKED | BUTTON1_PRESSED)) {
                         // 坐标转换逻辑
                         int mouse_grid_y = (event.y - start_y) / CELL_HEIGHT;
@@ -444,21 +443,11 @@ void Game::single_mode_start() {
                             selected_x = cur_x;
                             selected_y = cur_y;
                             if (selected_piece != EMPTY && selected_piece * (current_round % 2 == 1 ? 1 : -1) > 0) {
-                                predicted_moves = {
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                };
-                                predict_move(cur_y, cur_x, predicted_moves);
+                                predicted_moves = legal_targets[SQ(cur_y, cur_x)];
                             }
                         } else {
                             int target_piece = board[cur_y][cur_x];
-                            if (predicted_moves[cur_y][cur_x] != 0 && (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0 || target_piece == 0)) {
+                            if ((predicted_moves & BIT(SQ(cur_y, cur_x))) && (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0 || target_piece == 0)) {
                                 // 捕获棋子
                                 if (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0) {
                                     if (current_round % 2 == 1) {
@@ -476,53 +465,15 @@ void Game::single_mode_start() {
                                 selected_y = 0;
                                 current_round++;
 
-                                predicted_moves = {
-                                    {0, 0, 0, 0, 0, 0, 0, 0},
-                                    {0, 0, 0, 0, 0, 0, 0, 0},
-                                    {0, 0, 0, 0, 0, 0, 0, 0},
-                                    {0, 0, 0, 0, 0, 0, 0, 0},
-                                    {0, 0, 0, 0, 0, 0, 0, 0},
-                                    {0, 0, 0, 0, 0, 0, 0, 0},
-                                    {0, 0, 0, 0, 0, 0, 0, 0},
-                                    {0, 0, 0, 0, 0, 0, 0, 0},
-                                };
-
-                                // 检查是否将军
-                                if (is_in_check(1)) {
-                                    if (is_checkmate(1)) {
-                                        white_in_checkmate = true;
-                                    } else {
-                                        white_in_check = true;
-                                    }
-                                } else {
-                                    white_in_check = false;
-                                }
+                                predicted_moves = 0;
 
-                                if (is_in_check(-1)) {
-                                    if (is_checkmate(-1)) {
-                                        black_in_checkmate = true;
-                                    } else {
-                                        black_in_check = true;
-                                    }
-                                } else {
-                                    black_in_check = false;
-                                }
                             } else {
                                 selected_piece = board[cur_y][cur_x];
                                 selected_x = cur_x;
                                 selected_y = cur_y;
-                                predicted_moves = {
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                };
+                                predicted_moves = 0;
                                 if (selected_piece != EMPTY && selected_piece * (current_round % 2 == 1 ? 1 : -1) > 0) {
-                                    predict_move(cur_y, cur_x, predicted_moves);
+                                    predicted_moves = legal_targets[SQ(cur_y, cur_x)];
                                 }
                             }
                         }
@@ -551,23 +502,13 @@ void Game::single_mode_start() {
                     selected_x = cur_x;
                     selected_y = cur_y;
                     if (selected_piece != EMPTY && selected_piece * (current_round % 2 == 1 ? 1 : -1) > 0) {
-                        predicted_moves = {
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        {0, 0, 0, 0, 0, 0, 0, 0},
-                        };
-                        predict_move(cur_y, cur_x, predicted_moves);
+                        predicted_moves = legal_targets[SQ(cur_y, cur_x)];
                     }
                 }
                 if (ch == '\n') { //处理键盘确认键
                     if (choose) {
                         int target_piece = board[cur_y][cur_x];
-                        if (predicted_moves[cur_y][cur_x] != 0 && (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0 || target_piece == 0)) {
+                        if ((predicted_moves & BIT(SQ(cur_y, cur_x))) && (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0 || target_piece == 0)) {
                             // 捕获棋子
                             if (target_piece * (current_round % 2 == 1 ? 1 : -1) < 0) {
                                 if (current_round % 2 == 1) {
@@ -586,53 +527,15 @@ void Game::single_mode_start() {
                             choose = false;
                             current_round++;
 
-                            predicted_moves = {
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                                {0, 0, 0, 0, 0, 0, 0, 0},
-                            };
-
-                            // 检查是否将军
-                            if (is_in_check(1)) {
-                                if (is_checkmate(1)) {
-                                    white_in_checkmate = true;
-                                } else {
-                                    white_in_check = true;
-                                }
-                            } else {
-                                white_in_check = false;
-                            }
+                            predicted_moves = 0;
 
-                            if (is_in_check(-1)) {
-                                if (is_checkmate(-1)) {
-                                    black_in_checkmate = true;
-                                } else {
-                                    black_in_check = true;
-                                }
-                            } else {
-                                black_in_check = false;
-                            }
                         } else {
                             selected_piece = board[cur_y][cur_x];
                             selected_x = cur_x;
                             selected_y = cur_y;
-                            predicted_moves = {
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            {0, 0, 0, 0, 0, 0, 0, 0},
-                            };
+                            predicted_moves = 0;
                             if (selected_piece != EMPTY && selected_piece * (current_round % 2 == 1 ? 1 : -1) > 0) {
-                                predict_move(cur_y, cur_x, predicted_moves);
+                                predicted_moves = legal_targets[SQ(cur_y, cur_x)];
                             }
                         }
                     } else {
@@ -644,8 +547,21 @@ void Game::single_mode_start() {
                 }
             }
         } else {
+            // 搜索期间不会重绘，状态行要立即刷新出来
             mvprintw(0, 0, "AI Thinking...");
+            refresh();
+            if (clock_enabled) {
+                ai_player.set_clock(remaining_ms(1), clock_increment_ms);
+            }
+            uint64_t ai_start = latency_now_us();
             int captured_piece = ai_player.make_move();
+            latency.record_since(STAGE_AI, ai_start);
+            if (!ai_player.last_move_from_book()) {
+                search_stats = &ai_player.last_stats();
+                if (!stats_path.empty()) {
+                    dump_stats(*search_stats, stats_path.c_str(), stats_prometheus);
+                }
+            }
             if (captured_piece != 0) {
                 if (captured_piece) {
                     if (current_round % 2 == 1) {
@@ -657,38 +573,57 @@ void Game::single_mode_start() {
             }
             
             current_round++;
-            // 检查是否将军
-            if (is_in_check(1)) {
-                if (is_checkmate(1)) {
-                    white_in_checkmate = true;
-                } else {
-                    white_in_check = true;
-                }
-            } else {
-                white_in_check = false;
-            }
 
-            if (is_in_check(-1)) {
-                if (is_checkmate(-1)) {
-                    black_in_checkmate = true;
-                } else {
-                    black_in_check = true;
-                }
-            } else {
-                black_in_check = false;
-            }
-
-            mvprintw(0, 0, "AI Waiting...");
+            // 局部重绘不会清掉第 0 行，走完后把状态行擦掉
+            move(0, 0);
+            clrtoeol();
         }
     }
 
     // 按q或Q退出游戏
+    timeout(-1);
     while (true) {
-        int ch = getch();
+        int ch = session_getch();
         if (ch == 'q' || ch == 'Q') break;
     }
 }
 
+// 每回合只计算一次局面状态（将军、将死、逼和）和当前走棋方的全部合法走法，
+// 合法走法按起点格存为目标格掩码
+void Game::update_legal_moves() {
+    if (legal_round == current_round) {
+        return;
+    }
+    int turn = current_round % 2 == 1 ? 1 : -1;
+    Position pos;
+    pos.set_board(board, turn);
+    game_status = status_cache.probe(pos);
+
+    // 只有轮到走棋的一方可能处于被将军状态
+    white_in_check = turn == 1 && game_status == STATUS_CHECK;
+    black_in_check = turn == -1 && game_status == STATUS_CHECK;
+    white_in_checkmate = turn == 1 && game_status == STATUS_CHECKMATE;
+    black_in_checkmate = turn == -1 && game_status == STATUS_CHECKMATE;
+    stalemate = game_status == STATUS_STALEMATE;
+
+    // 提示只对出题时的局面有效
+    hint_count = 0;
+    hint_moves = 0;
+
+    for (int sq = 0; sq < 64; sq++) {
+        legal_targets[sq] = 0;
+    }
+    MoveCode moves[MAX_MOVES];
+    int count = 0;
+    if (game_status == STATUS_NORMAL || game_status == STATUS_CHECK) {
+        count = generate_legal_moves(pos, moves);
+    }
+    for (int i = 0; i < count; i++) {
+        legal_targets[move_from(moves[i])] |= BIT(move_to(moves[i]));
+    }
+    legal_round = current_round;
+}
+
 int Game::calculate_score(int side) {
     int total = 0;
     for (int i = 0; i < 8; i++) {
@@ -700,12 +635,18 @@ int Game::calculate_score(int side) {
 }
 
 void Game::draw_dashboard(int start_y, int start_x, int turn, int round) {
-    int width = 24; // 压缩宽度
+    int width = DASHBOARD_WIDTH;
     int current_y = start_y;
 
-    // 1. 刷背景
+    // 1. 清除上一次绘制的内容（警告信息比背景宽），再刷背景
+    attrset(A_NORMAL);
+    for (int h = 0; h < DASHBOARD_LINES; h++) {
+        move(start_y + h, start_x);
+        clrtoeol();
+    }
     attron(COLOR_PAIR(31));
-    for (int h = 0; h < 12; h++) {
+    int height = (book.is_open() ? 17 : 12) + (search_stats ? 4 : 0) + (hint_count ? hint_count + 1 : 0);
+    for (int h = 0; h < height; h++) {
         mvhline(start_y + h, start_x, ' ', width);
     }
 
@@ -744,7 +685,7 @@ void Game::draw_dashboard(int start_y, int start_x, int turn, int round) {
     attroff(COLOR_PAIR(33) | A_BOLD);
     current_y += 1;
 
-    if (is_in_check(turn)) {
+    if (game_status == STATUS_CHECK) {
         attron(COLOR_PAIR(34) | A_BOLD | A_BLINK);
         mvprintw(current_y, start_x + 4, " !!!  UNDER CHECK  !!! ");
         attroff(COLOR_PAIR(34) | A_BOLD | A_BLINK);
@@ -752,24 +693,205 @@ void Game::draw_dashboard(int start_y, int start_x, int turn, int round) {
     current_y += 1;
 
     // 7. 快捷键提示 (极简)
-    mvprintw(current_y++, start_x, "U:Undo S:Save Q:Exit");
+    mvprintw(current_y++, start_x, "H:Hint U:Undo S:Save Q:Exit");
+    current_y += 1;
+
+    // 8. 开局库中的常见后续
+    current_y = draw_book(current_y, start_x, turn);
+
+    // 9. AI 搜索统计
+    current_y = draw_search_stats(current_y, start_x);
+
+    // 10. 提示走法
+    current_y = draw_hints(current_y, start_x);
     attroff(COLOR_PAIR(31));
     attrset(A_NORMAL);
 }
 
+int Game::draw_book(int start_y, int start_x, int turn) {
+    if (!book.is_open()) {
+        return start_y;
+    }
+    int current_y = start_y;
+    mvprintw(current_y++, start_x, "Book:");
+
+    BookEntry entries[3];
+    int n = book.probe(compute_board_key(board, turn), entries, 3);
+    if (n == 0) {
+        mvprintw(current_y++, start_x, " (out of book)");
+    }
+    for (int i = 0; i < n; i++) {
+        char move[6];
+        move_to_string(entries[i].move, move);
+        uint32_t games = book_games(entries[i]);
+        // 得分率：胜 1 分、和 0.5 分，从当前走棋方视角
+        uint32_t wins = turn == 1 ? entries[i].white_wins : entries[i].black_wins;
+        int score = (int)(((uint64_t)wins * 2 + entries[i].draws) * 50 / games);
+        mvprintw(current_y++, start_x, " %-5s %7u %3d%%", move, games, score);
+    }
+    return current_y;
+}
+
+int Game::draw_search_stats(int start_y, int start_x) {
+    if (!search_stats) {
+        return start_y;
+    }
+    const SearchStats& s = *search_stats;
+    int current_y = start_y;
+    mvprintw(current_y++, start_x, "AI: d%d/%d %lluk nodes", s.depth, s.seldepth, (unsigned long long)(s.nodes / 1000));
+    mvprintw(current_y++, start_x, " %lluk nps %.0f ms", (unsigned long long)(s.nps / 1000), s.time_ms);
+#if SEARCH_STATS_ENABLED
+    int tt_rate = s.tt_probes ? (int)(s.tt_hits * 100 / s.tt_probes) : 0;
+    int fmc_rate = s.beta_cutoffs ? (int)(s.first_move_cutoffs * 100 / s.beta_cutoffs) : 0;
+    mvprintw(current_y++, start_x, " TT %d%% FMC %d%%", tt_rate, fmc_rate);
+#endif
+    return current_y;
+}
+
+// 每次循环调用：回合变化说明上一方已经走棋，结算其用时并加秒；
+// 当前走棋方时间用完即判负
+void Game::update_clocks() {
+    if (!clock_enabled) {
+        return;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (clock_round != current_round) {
+        int mover = clock_round % 2 == 1 ? 0 : 1;
+        clock_ms[mover] = remaining_ms(mover);
+        if (clock_ms[mover] <= 0) {
+            time_forfeit = mover == 0 ? 1 : -1;
+            return;
+        }
+        clock_ms[mover] += clock_increment_ms;
+        clock_round = current_round;
+        turn_start = now;
+    }
+    int side = current_round % 2 == 1 ? 0 : 1;
+    if (remaining_ms(side) <= 0) {
+        time_forfeit = side == 0 ? 1 : -1;
+    }
+}
+
+// 正在走棋的一方要减去本回合已经用掉的时间
+int Game::remaining_ms(int color) const {
+    int remaining = clock_ms[color];
+    if (color == (clock_round % 2 == 1 ? 0 : 1)) {
+        remaining -= (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - turn_start).count();
+    }
+    return remaining;
+}
+
+void Game::draw_clocks(int start_y, int start_x) {
+    if (!clock_enabled) {
+        return;
+    }
+    char text[2][16];
+    for (int color = 0; color < 2; color++) {
+        int ms = remaining_ms(color);
+        if (ms < 0) {
+            ms = 0;
+        }
+        // 不足 10 秒时显示十分之一秒
+        if (ms < 10000) {
+            snprintf(text[color], sizeof(text[color]), "%d.%d", ms / 1000, ms / 100 % 10);
+        } else {
+            snprintf(text[color], sizeof(text[color]), "%d:%02d", ms / 60000, ms / 1000 % 60);
+        }
+    }
+    int side = current_round % 2 == 1 ? 0 : 1;
+    attrset(COLOR_PAIR(31));
+    mvhline(start_y, start_x, ' ', DASHBOARD_WIDTH);
+    attron(COLOR_PAIR(32) | (side == 0 ? A_BOLD : 0));
+    mvprintw(start_y, start_x, "W %s", text[0]);
+    attrset(COLOR_PAIR(33) | (side == 1 ? A_BOLD : 0));
+    mvprintw(start_y, start_x + 12, "B %s", text[1]);
+    attrset(A_NORMAL);
+}
+
+void Game::set_time_control(int base_ms, int increment_ms) {
+    clock_enabled = base_ms > 0;
+    clock_base_ms = base_ms;
+    clock_increment_ms = increment_ms > 0 ? increment_ms : 0;
+}
+
+// 提示按节点数限制，不同机器上给出相同的结果
+void Game::show_hint() {
+    int turn = current_round % 2 == 1 ? 1 : -1;
+    Position pos;
+    pos.set_board(board, turn);
+    if (!has_legal_move(pos)) {
+        return;
+    }
+    SearchLimits limits;
+    memset(&limits, 0, sizeof(limits));
+    limits.nodes = HINT_NODES;
+    hint_count = analysis.analyze(pos, limits, HINT_LINES, hint_lines);
+    hint_moves = 0;
+    for (int i = 0; i < hint_count; i++) {
+        hint_moves |= BIT(move_from(hint_lines[i].best_move)) | BIT(move_to(hint_lines[i].best_move));
+    }
+    dashboard_round = 0;
+}
+
+// 每条提示显示首步、分数（以兵为单位，走棋方视角）和主变例的前两步
+int Game::draw_hints(int start_y, int start_x) {
+    if (hint_count == 0) {
+        return start_y;
+    }
+    int current_y = start_y;
+    mvprintw(current_y++, start_x, "Hint:");
+    for (int i = 0; i < hint_count; i++) {
+        const SearchResult& line = hint_lines[i];
+        char moves[3][6] = {"", "", ""};
+        for (int j = 0; j < 3 && j < line.pv_length; j++) {
+            move_to_string(line.pv[j], moves[j]);
+        }
+        if (abs(line.score) >= SCORE_MATE_IN_MAX) {
+            int mate = (SCORE_MATE - abs(line.score) + 1) / 2;
+            mvprintw(current_y++, start_x, " %-5s %sM%-3d %s %s", moves[0], line.score > 0 ? "+" : "-", mate,
+                     moves[1], moves[2]);
+        } else {
+            mvprintw(current_y++, start_x, " %-5s %+5.2f %s %s", moves[0], line.score / 100.0, moves[1], moves[2]);
+        }
+    }
+    return current_y;
+}
+
+void Game::set_stats_output(const char* path, bool prometheus) {
+    stats_path = path;
+    stats_prometheus = prometheus;
+}
+
+bool Game::load_book(const char* path) {
+    return book.open(path);
+}
+
 void Game::restart() {
     current_round = 1;
     white_in_check = false;
     black_in_check = false;
     white_in_checkmate = false;
     black_in_checkmate = false;
+    stalemate = false;
+    game_status = STATUS_NORMAL;
+    search_stats = NULL;
     white_cap_count = 0;
     black_cap_count = 0;
     selected_piece = 0;
     selected_x = 0;
     selected_y = 0;
-    predicted_moves = std::vector<std::vector<int>>(8, std::vector<int>(8, 0));
+    predicted_moves = 0;
+    legal_round = 0;
     choose = false;
+    frame_valid = false;
+
+    clock_ms[0] = clock_ms[1] = clock_base_ms;
+    clock_round = current_round;
+    turn_start = std::chrono::steady_clock::now();
+    time_forfeit = 0;
+    hint_count = 0;
+    hint_moves = 0;
 
     for (int i = 0; i < 8; i++) {
         for (int j = 0; j < 8; j++) {
@@ -0,0 +1,94 @@
+#include "latency.h"
+#include <chrono>
+#include <cstring>
+
+const char* const latency_stage_names[STAGE_COUNT] = {
+    "getch", "handler", "rules", "draw_ui", "dashboard", "output", "frame", "ai"
+};
+
+uint64_t latency_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 值 v 所在的桶：v >= LATENCY_SUB_COUNT 时取最高 LATENCY_SUB_BITS 位，shift 为丢掉的低位数
+static int bucket_of(uint64_t v) {
+    if (v < LATENCY_SUB_COUNT) {
+        return (int)v;
+    }
+    int shift = 63 - __builtin_clzll(v) - LATENCY_SUB_BITS + 1;
+    return shift * (LATENCY_SUB_COUNT / 2) + (int)(v >> shift);
+}
+
+static uint64_t bucket_upper(int bucket) {
+    if (bucket < LATENCY_SUB_COUNT) {
+        return bucket;
+    }
+    int shift = bucket / (LATENCY_SUB_COUNT / 2) - 1;
+    uint64_t sub = bucket - shift * (LATENCY_SUB_COUNT / 2);
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::reset() {
+    memset(counts, 0, sizeof(counts));
+    total = sum = max_value = 0;
+}
+
+void LatencyHistogram::record(uint64_t us) {
+    const uint64_t limit = (1ULL << LATENCY_MAX_BITS) - 1;
+    if (us > limit) {
+        us = limit;
+    }
+    counts[bucket_of(us)]++;
+    total++;
+    sum += us;
+    if (us > max_value) {
+        max_value = us;
+    }
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p / 100.0 * total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+    uint64_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper(b);
+            return upper < max_value ? upper : max_value;
+        }
+    }
+    return max_value;
+}
+
+void LatencyProfile::reset() {
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        stages[s].reset();
+    }
+}
+
+void LatencyProfile::write(FILE* out) const {
+    fprintf(out, "%-10s %8s %10s %10s %10s %10s %10s %10s\n",
+            "stage(us)", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        const LatencyHistogram& h = stages[s];
+        fprintf(out, "%-10s %8llu %10.1f %10llu %10llu %10llu %10llu %10llu\n", latency_stage_names[s],
+                (unsigned long long)h.count(), h.mean(),
+                (unsigned long long)h.percentile(50), (unsigned long long)h.percentile(90),
+                (unsigned long long)h.percentile(99), (unsigned long long)h.percentile(99.9),
+                (unsigned long long)h.max());
+    }
+}
+
+bool LatencyProfile::dump(const char* path) const {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        return false;
+    }
+    write(out);
+    return fclose(out) == 0;
+}
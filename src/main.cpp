@@ -1,11 +1,21 @@
 #include "game.h"
+#include "bench.h"
+#include "cpu.h"
+#include "session.h"
+#include "tablebase.h"
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <ncurses.h>
 #include <locale.h>
 
 typedef enum { MENU, SINGLE_PLAYER, DOUBLE_PLAYER, EXIT } GameState;
 
-void draw_menu(int highlighted) {
+#define MENU_ITEMS 4
+#define MENU_DIFFICULTY 2
+
+void draw_menu(int highlighted, int difficulty) {
     clear();
     int rows, cols;
     getmaxyx(stdscr, rows, cols);
@@ -34,13 +44,17 @@ void draw_menu(int highlighted) {
     attroff(A_BOLD | COLOR_PAIR(3));
 
     // --- 按钮部分 ---
+    // 难度一栏用左右键切换
+    char level[32];
+    snprintf(level, sizeof(level), " [  AI: < %-8s >    ] ", difficulty_levels[difficulty].name);
     const char* options[] = {
         " [  Single Player Mode  ] ",
         " [  Double Player Mode  ] ",
+        level,
         " [      Exit Game       ] "
     };
 
-    for (int i = 0; i < 3; i++) {
+    for (int i = 0; i < MENU_ITEMS; i++) {
         int opt_width = strlen(options[i]);
         int opt_x = (cols - opt_width) / 2;
         int opt_y = rows/2 + i * 2 + 1;
@@ -55,15 +69,139 @@ void draw_menu(int highlighted) {
     }
 
     // 底部提示语
-    const char* hint = "Use arrow keys to navigate, Enter to select.";
+    const char* hint = "Arrows: navigate / change AI level, Enter: select.";
     mvprintw(rows - 2, (cols - strlen(hint))/2, "%s", hint);
 
     refresh();
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // --cpu NAME 强制使用某个指令集版本的内核，先处理并从参数中去掉，不影响其余参数的位置
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--cpu") == 0) {
+            if (!cpu_select(argv[i + 1])) {
+                fprintf(stderr, "unsupported cpu variant: %s\n", argv[i + 1]);
+                return 1;
+            }
+            for (int j = i; j + 2 <= argc; j++) {
+                argv[j] = argv[j + 2];
+            }
+            argc -= 2;
+            break;
+        }
+    }
+
+    // chess bench [depth] [threads] [hash_mb]：不进入界面，输出搜索节点数签名
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        int depth = argc > 2 ? atoi(argv[2]) : 7;
+        int threads = argc > 3 ? atoi(argv[3]) : 1;
+        int hash_mb = argc > 4 ? atoi(argv[4]) : 16;
+        return run_search_bench(depth > 0 ? depth : 7, threads > 0 ? threads : 1, hash_mb > 0 ? hash_mb : 16);
+    }
+
+    const char* book_path = "book.bin";
+    const char* tb_path = NULL;
+    const char* stats_path = NULL;
+    const char* latency_path = "latency.txt";
+    const char* record_path = NULL;
+    const char* replay_path = NULL;
+    bool realtime = false;
+    bool stats_prometheus = false;
+    unsigned seed = 1;          // 不给 --seed 时与未调用 srand 的默认序列相同
+    bool seed_given = false;
+    int clock_base_ms = 0;
+    int clock_increment_ms = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--book") == 0 && i + 1 < argc) {
+            book_path = argv[++i];
+        } else if (strcmp(argv[i], "--stats-file") == 0 && i + 1 < argc) {
+            stats_path = argv[++i];
+        } else if (strcmp(argv[i], "--stats-format") == 0 && i + 1 < argc) {
+            stats_prometheus = strcmp(argv[++i], "prometheus") == 0;
+        } else if (strcmp(argv[i], "--latency-file") == 0 && i + 1 < argc) {
+            latency_path = argv[++i];
+        } else if (strcmp(argv[i], "--tb") == 0 && i + 1 < argc) {
+            tb_path = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            // AI 的扰动种子和开局库选择都来自 rand()，固定种子即可复现整盘棋
+            seed = (unsigned)atoi(argv[++i]);
+            seed_given = true;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = true;
+        } else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            // 格式为 分钟+加秒，例如 5+3
+            char* rest;
+            clock_base_ms = (int)(strtod(argv[++i], &rest) * 60000);
+            clock_increment_ms = *rest == '+' ? (int)(strtod(rest + 1, NULL) * 1000) : 0;
+        }
+    }
+
+    // 回放时种子、棋钟、开局库和残局库都取自日志；录制时没有指定种子就随机取一个，写进日志
+    SessionHeader header;
+    memset(&header, 0, sizeof(header));
+    if (replay_path) {
+        if (!session_replay(replay_path, header, realtime)) {
+            fprintf(stderr, "cannot replay %s\n", replay_path);
+            return 1;
+        }
+        seed = header.seed;
+        clock_base_ms = header.clock_base_ms;
+        clock_increment_ms = header.clock_increment_ms;
+        book_path = header.book;
+        tb_path = header.tb[0] ? header.tb : NULL;
+        if (clock_base_ms > 0) {
+            fprintf(stderr, "warning: %s is a timed session; clocks and AI time budgets follow the replay's "
+                            "wall time, so moves may differ from the recording\n", replay_path);
+        }
+    } else if (record_path) {
+        if (!seed_given) {
+            seed = (unsigned)time(NULL);
+        }
+        header.seed = seed;
+        header.clock_base_ms = clock_base_ms;
+        header.clock_increment_ms = clock_increment_ms;
+        if (strlen(book_path) >= SESSION_PATH_SIZE || (tb_path && strlen(tb_path) >= SESSION_PATH_SIZE)) {
+            fprintf(stderr, "book or tablebase path too long to record\n");
+            return 1;
+        }
+        strcpy(header.book, book_path);
+        strcpy(header.tb, tb_path ? tb_path : "");
+        if (!session_record(record_path, header)) {
+            fprintf(stderr, "cannot write %s\n", record_path);
+            return 1;
+        }
+    }
+    srand(seed);
+    if (tb_path) {
+        tb_load(tb_path);
+    }
+
     setlocale(LC_ALL, "");
-    initscr();
+    // 回放不需要终端：屏幕输出到 /dev/null，尺寸固定，绘制代码照常执行
+    SCREEN* screen = NULL;
+    FILE* null_out = NULL;
+    FILE* null_in = NULL;
+    if (replay_path) {
+        setenv("LINES", "40", 1);
+        setenv("COLUMNS", "120", 1);
+        use_env(TRUE);
+        null_out = fopen("/dev/null", "w");
+        null_in = fopen("/dev/null", "r");
+        const char* term = getenv("TERM");
+        screen = null_out && null_in ? newterm(term && *term ? term : "xterm", null_out, null_in) : NULL;
+        if (!screen) {
+            fprintf(stderr, "cannot open a headless screen\n");
+            return 1;
+        }
+        set_term(screen);
+    } else {
+        initscr();
+    }
+    uint64_t session_start = latency_now_us();
     start_color();
     cbreak();
     noecho();
@@ -114,20 +252,40 @@ int main() {
     int highlighted = 0;
 
     Game board;
+    board.load_book(book_path);
+    if (stats_path) {
+        board.set_stats_output(stats_path, stats_prometheus);
+    }
+    board.set_time_control(clock_base_ms, clock_increment_ms);
     while (state != EXIT) {
         if (state == MENU) {
-            draw_menu(highlighted);
-            int ch = getch();
+            draw_menu(highlighted, board.get_difficulty());
+            // 回放的日志读完后直接退出
+            if (session_finished()) {
+                state = EXIT;
+                break;
+            }
+            int ch = session_getch();
             switch (ch) {
                 case KEY_UP:
-                    highlighted = (highlighted + 2) % 3;
+                    highlighted = (highlighted + MENU_ITEMS - 1) % MENU_ITEMS;
                     break;
                 case KEY_DOWN:
-                    highlighted = (highlighted + 1) % 3;
+                    highlighted = (highlighted + 1) % MENU_ITEMS;
+                    break;
+                case KEY_LEFT:
+                case KEY_RIGHT:
+                    if (highlighted == MENU_DIFFICULTY) {
+                        int step = ch == KEY_RIGHT ? 1 : DIFFICULTY_COUNT - 1;
+                        board.set_difficulty((board.get_difficulty() + step) % DIFFICULTY_COUNT);
+                    }
                     break;
                 case '\n': // 回车
                     if (highlighted == 0) state = SINGLE_PLAYER;
                     else if (highlighted == 1) state = DOUBLE_PLAYER;
+                    else if (highlighted == MENU_DIFFICULTY) {
+                        board.set_difficulty((board.get_difficulty() + 1) % DIFFICULTY_COUNT);
+                    }
                     else state = EXIT;
                     break;
             }
@@ -145,5 +303,19 @@ int main() {
     }
 
     endwin();
+    uint64_t session_us = latency_now_us() - session_start;
+    if (screen) {
+        delscreen(screen);
+        fclose(null_out);
+        fclose(null_in);
+    }
+    if (!board.dump_latency(latency_path)) {
+        fprintf(stderr, "cannot write %s\n", latency_path);
+    }
+    if (replay_path) {
+        printf("replayed %llu events in %.1f ms\n", (unsigned long long)session_event_count(), session_us / 1000.0);
+        board.write_latency(stdout);
+    }
+    session_close();
     return 0;
 }
\ No newline at end of file
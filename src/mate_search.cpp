@@ -0,0 +1,405 @@
+#include "mate_search.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// 证明数的无穷大，两个数相加不会溢出
+#define MATE_INF (1u << 30)
+
+// 不将军的着法很难逼出杀，初始证明数设得大一些，让搜索先走将军的分支
+#define QUIET_PROOF_NUMBER 8
+
+static uint32_t add_capped(uint32_t a, uint32_t b) {
+    uint32_t sum = a + b;
+    return sum >= MATE_INF ? MATE_INF : sum;
+}
+
+MateSolver::MateSolver() : table(NULL), bucket_mask(0), attacker(1), checks_only(false),
+                           nodes(0), node_limit(0), aborted(false) {
+}
+
+MateSolver::~MateSolver() {
+    free(table);
+}
+
+void MateSolver::set_hash(size_t mb) {
+    free(table);
+    size_t buckets = 1;
+    while ((buckets * 2) * MATE_BUCKET_SIZE * sizeof(MateEntry) <= (mb << 20)) {
+        buckets *= 2;
+    }
+    table = (MateEntry*)calloc(buckets * MATE_BUCKET_SIZE, sizeof(MateEntry));
+    if (!table) {
+        throw std::bad_alloc();
+    }
+    bucket_mask = buckets - 1;
+}
+
+void MateSolver::clear() {
+    memset(table, 0, (bucket_mask + 1) * MATE_BUCKET_SIZE * sizeof(MateEntry));
+}
+
+// 证明在更深的剩余层数下仍然成立，否定在更浅时仍然成立；中间结果只是估计值，不同层数之间也可以借用
+bool MateSolver::lookup(uint64_t key, int depth, uint32_t& pn, uint32_t& dn) const {
+    const MateEntry* bucket = table + (key & bucket_mask) * MATE_BUCKET_SIZE;
+    const MateEntry* estimate = NULL;
+    for (int i = 0; i < MATE_BUCKET_SIZE; i++) {
+        const MateEntry& e = bucket[i];
+        if (e.key != key || e.work == 0) {
+            continue;
+        }
+        if ((e.pn == 0 && e.depth <= depth) || (e.dn == 0 && e.depth >= depth)) {
+            pn = e.pn;
+            dn = e.dn;
+            return true;
+        }
+        if (e.pn != 0 && e.dn != 0) {
+            estimate = &e;
+        }
+    }
+    if (estimate) {
+        pn = estimate->pn;
+        dn = estimate->dn;
+        return true;
+    }
+    return false;
+}
+
+// 已证明有杀时返回证明时的剩余层数，否则返回 -1
+int MateSolver::proof_depth(uint64_t key) const {
+    const MateEntry* bucket = table + (key & bucket_mask) * MATE_BUCKET_SIZE;
+    for (int i = 0; i < MATE_BUCKET_SIZE; i++) {
+        if (bucket[i].key == key && bucket[i].work != 0 && bucket[i].pn == 0) {
+            return bucket[i].depth;
+        }
+    }
+    return -1;
+}
+
+// 同一局面的证明单独占一个条目，不会被较浅层数的中间结果覆盖，提取主变例时还要用到
+void MateSolver::store(uint64_t key, int depth, uint32_t pn, uint32_t dn, uint32_t work) {
+    MateEntry* bucket = table + (key & bucket_mask) * MATE_BUCKET_SIZE;
+    MateEntry* replace = NULL;
+    MateEntry* proof = NULL;
+    for (int i = 0; i < MATE_BUCKET_SIZE; i++) {
+        if (bucket[i].key != key || bucket[i].work == 0) {
+            continue;
+        }
+        if (bucket[i].pn == 0) {
+            proof = &bucket[i];
+        } else {
+            replace = &bucket[i];
+        }
+    }
+    if (pn == 0) {
+        if (proof) {
+            // 保留层数更少的证明
+            if (proof->depth <= depth) {
+                return;
+            }
+            replace = proof;
+        }
+    }
+    if (!replace) {
+        for (int i = 0; i < MATE_BUCKET_SIZE; i++) {
+            if (&bucket[i] != proof && (!replace || bucket[i].work < replace->work)) {
+                replace = &bucket[i];
+            }
+        }
+    }
+    replace->key = key;
+    replace->pn = pn;
+    replace->dn = dn;
+    replace->work = work > 0 ? work : 1;
+    replace->depth = (int16_t)depth;
+}
+
+// 合法着法；checks_only 时攻击方只保留将军的着法
+int MateSolver::generate(MoveCode* moves, bool or_node) {
+    int count = generate_legal_moves(pos, moves);
+    if (!or_node || !checks_only) {
+        return count;
+    }
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        Undo undo;
+        pos.do_move(moves[i], undo);
+        if (pos.in_check(pos.side)) {
+            moves[n++] = moves[i];
+        }
+        pos.undo_move(undo);
+    }
+    return n;
+}
+
+bool MateSolver::on_path(uint64_t key, int ply) const {
+    for (int i = ply - 2; i >= 0; i -= 2) {
+        if (path[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 以轮到走棋的一方计：phi 为它取胜所需的证明数，delta 为它落败所需的证明数。
+// phi(n) = 子节点 delta 的最小值；delta(n) 用弱证明数：子节点 phi 的最大值加上未解决的子节点数减一，
+// 避免直接求和时数值随深度指数增长，也减轻同一局面经不同路径被重复计数。两者超过阈值时返回。
+// 结果写入置换表，同时通过 pn / dn 返回，条目被挤掉时调用方仍能取得最新的值。
+// 因路径上的重复局面而得出的否定只在当前路径上成立（图历史问题），dependent 置位且不写入置换表
+void MateSolver::mid(int depth, int ply, uint32_t th_phi, uint32_t th_delta, uint32_t& pn, uint32_t& dn,
+                     bool& dependent) {
+    bool or_node = pos.side == attacker;
+    uint64_t start = nodes++;
+    if (node_limit && nodes >= node_limit) {
+        aborted = true;
+    }
+    path[ply] = pos.key;
+    dependent = false;
+
+    // 攻击方没有剩余层数时不必生成着法
+    if (or_node && depth <= 0) {
+        pn = MATE_INF;
+        dn = 0;
+        store(pos.key, depth, pn, dn, 1);
+        return;
+    }
+    MoveCode moves[MAX_MOVES];
+    int count = generate(moves, or_node);
+    if (count == 0 || depth <= 0) {
+        // 防守方无着可走且被将军即为杀，其余情况（攻击方无着、逼和、层数用完）都否定
+        bool mated = count == 0 && !or_node && pos.in_check(pos.side);
+        pn = mated ? 0 : MATE_INF;
+        dn = mated ? MATE_INF : 0;
+        store(pos.key, mated ? 0 : depth, pn, dn, 1);
+        return;
+    }
+
+    // 子节点的键和置换表中查不到时使用的值（攻击方视角），先填初始值，搜索过后更新
+    uint64_t keys[MAX_MOVES];
+    uint32_t init_pn[MAX_MOVES];
+    uint32_t init_dn[MAX_MOVES];
+    bool child_dependent[MAX_MOVES];
+    for (int i = 0; i < count; i++) {
+        child_dependent[i] = false;
+        Undo undo;
+        pos.do_move(moves[i], undo);
+        keys[i] = pos.key;
+        init_pn[i] = 1;
+        init_dn[i] = 1;
+        if (or_node) {
+            // 将军时应将的着法越少越容易证明，没有应将着法就是杀
+            if (pos.in_check(pos.side)) {
+                MoveCode replies[MAX_MOVES];
+                int n = generate_legal_moves(pos, replies);
+                init_pn[i] = n > 0 ? n : 0;
+                init_dn[i] = n > 0 ? 1 : MATE_INF;
+                if (n == 0) {
+                    // 杀局直接记下，提取主变例时要用
+                    store(pos.key, 0, 0, MATE_INF, 1);
+                }
+            } else {
+                init_pn[i] = QUIET_PROOF_NUMBER;
+            }
+            // 攻击方的最后一步：不是杀就直接否定，不必再进入子节点
+            if (depth == 1 && init_pn[i] != 0) {
+                init_pn[i] = MATE_INF;
+                init_dn[i] = 0;
+            }
+        }
+        pos.undo_move(undo);
+    }
+
+    uint32_t phi, delta;
+    bool any_dependent, independent_disproof;
+    while (true) {
+        phi = MATE_INF;
+        delta = 0;
+        any_dependent = false;
+        independent_disproof = false;
+        int open = 0;
+        int best = 0;
+        uint32_t best_phi = 0;
+        uint32_t second = MATE_INF;
+        for (int i = 0; i < count; i++) {
+            uint32_t child_pn, child_dn;
+            bool dep = false;
+            if (on_path(keys[i], ply + 1)) {
+                // 重复局面按攻击方失败处理，避免在循环中打转
+                child_pn = MATE_INF;
+                child_dn = 0;
+                dep = true;
+            } else if (child_dependent[i]) {
+                // 依赖路径的否定没有写入置换表，用上次搜索返回的值
+                child_pn = init_pn[i];
+                child_dn = init_dn[i];
+                dep = true;
+            } else if (!lookup(keys[i], depth - 1, child_pn, child_dn)) {
+                child_pn = init_pn[i];
+                child_dn = init_dn[i];
+            }
+            if (child_dn == 0) {
+                if (dep) {
+                    any_dependent = true;
+                } else {
+                    independent_disproof = true;
+                }
+            }
+            // 子节点轮到另一方走棋
+            uint32_t child_phi = or_node ? child_dn : child_pn;
+            uint32_t child_delta = or_node ? child_pn : child_dn;
+            if (child_phi > delta) {
+                delta = child_phi;
+            }
+            if (child_phi != 0) {
+                open++;
+            }
+            if (child_delta < phi) {
+                second = phi;
+                phi = child_delta;
+                best = i;
+                best_phi = child_phi;
+            } else if (child_delta < second) {
+                second = child_delta;
+            }
+        }
+        if (open > 1) {
+            delta = add_capped(delta, open - 1);
+        }
+        if (phi >= th_phi || delta >= th_delta || aborted) {
+            break;
+        }
+
+        uint32_t child_th_phi = th_delta - delta + best_phi;
+        // 1 + ε 技巧：给最佳子节点略多于次佳值的余量，减少在兄弟节点之间来回切换
+        uint32_t second_margin = second >= MATE_INF ? MATE_INF : second + second / 4 + 1;
+        uint32_t child_th_delta = th_phi < second_margin ? th_phi : second_margin;
+        Undo undo;
+        pos.do_move(moves[best], undo);
+        mid(depth - 1, ply + 1, child_th_phi, child_th_delta, init_pn[best], init_dn[best], child_dependent[best]);
+        pos.undo_move(undo);
+    }
+
+    pn = or_node ? phi : delta;
+    dn = or_node ? delta : phi;
+    // 攻击方走棋时所有着法都被否定，只要有一个依赖路径，结果就依赖路径；
+    // 防守方走棋时只要有一个不依赖路径的否定就够了
+    if (dn == 0) {
+        dependent = or_node ? any_dependent : !independent_disproof;
+    }
+    if (!dependent) {
+        store(pos.key, depth, pn, dn, (uint32_t)(nodes - start));
+    }
+}
+
+// 在 depth 层以内证明当前局面有杀（当前局面轮到攻击方时 depth 为奇数），用于提取主变例
+bool MateSolver::prove(int depth, int ply) {
+    int d = proof_depth(pos.key);
+    if (d >= 0 && d <= depth) {
+        return true;
+    }
+    uint32_t pn, dn;
+    bool dependent;
+    mid(depth, ply, MATE_INF, MATE_INF, pn, dn, dependent);
+    return pn == 0;
+}
+
+// 走出主变例直到将杀。攻击方选置换表中证明层数最少的着法，查不到时才重新证明；
+// 置换表里的层数只是上界，所以防守方的应着要重新证明：比已知最长的更长时从上界往下求出确切步数，选最长的
+void MateSolver::extract_pv(int depth, MateResult& result) {
+    Position start = pos;
+    result.pv_length = 0;
+    while (depth > 0 && result.pv_length < MAX_PLY && !aborted) {
+        int ply = result.pv_length;
+        path[ply] = pos.key;
+        bool or_node = pos.side == attacker;
+        MoveCode moves[MAX_MOVES];
+        int count = generate_legal_moves(pos, moves);
+        int best = -1, best_depth = 0;
+        for (int i = 0; i < count && !aborted; i++) {
+            Undo undo;
+            pos.do_move(moves[i], undo);
+            int d = -1;
+            if (or_node) {
+                d = proof_depth(pos.key);
+                if (d > depth - 1) {
+                    d = -1;
+                }
+            } else if ((best < 0 || !prove(best_depth, ply + 1)) && prove(depth - 1, ply + 1)) {
+                d = proof_depth(pos.key);
+                if (d < 0 || d > depth - 1) {
+                    d = depth - 1;
+                }
+                while (d - 2 > best_depth && prove(d - 2, ply + 1)) {
+                    int p = proof_depth(pos.key);
+                    d = p >= 0 && p < d - 2 ? p : d - 2;
+                }
+            } else if (best < 0) {
+                // 防守方有躲开杀的应着只可能是预算用完了
+                pos.undo_move(undo);
+                break;
+            }
+            pos.undo_move(undo);
+            if (d >= 0 && (best < 0 || (or_node ? d < best_depth : d > best_depth))) {
+                best = i;
+                best_depth = d;
+            }
+        }
+        for (int i = 0; or_node && best < 0 && i < count && !aborted; i++) {
+            Undo undo;
+            pos.do_move(moves[i], undo);
+            if (prove(depth - 1, ply + 1)) {
+                best = i;
+                best_depth = depth - 1;
+            }
+            pos.undo_move(undo);
+        }
+        if (best < 0) {
+            break;
+        }
+        Undo undo;
+        pos.do_move(moves[best], undo);
+        result.pv[result.pv_length++] = moves[best];
+        depth = best_depth;
+    }
+    pos = start;
+}
+
+MateResult MateSolver::solve(const Position& root, const MateLimits& limits) {
+    if (!table) {
+        set_hash(MATE_HASH_DEFAULT);
+    }
+    MateResult result;
+    memset(&result, 0, sizeof(result));
+    // 置换表中的 pn / dn 只对产生它们的攻击方和 checks_only 设置有效
+    clear();
+    pos = root;
+    attacker = root.side;
+    checks_only = limits.checks_only;
+    nodes = 0;
+    node_limit = limits.nodes;
+    aborted = false;
+
+    int max_moves = limits.max_moves > 0 && limits.max_moves < MATE_MAX_MOVES ? limits.max_moves : MATE_MAX_MOVES;
+    // 按杀的步数迭代加深，找到的杀一定最短
+    result.status = MATE_DISPROVEN;
+    for (int moves = 1; moves <= max_moves; moves++) {
+        int depth = 2 * moves - 1;
+        uint32_t pn, dn;
+        bool dependent;
+        mid(depth, 0, MATE_INF, MATE_INF, pn, dn, dependent);
+        if (pn == 0) {
+            result.status = MATE_PROVEN;
+            result.moves = moves;
+            // 只试将军着法时，含安静着法的更短的杀没有被否定（一步杀必然是将军）
+            result.shortest = !checks_only || moves == 1;
+            extract_pv(depth, result);
+            break;
+        }
+        if (dn != 0 || aborted) {
+            result.status = MATE_UNKNOWN;
+            break;
+        }
+    }
+    result.nodes = nodes;
+    return result;
+}
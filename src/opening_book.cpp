@@ -0,0 +1,71 @@
+#include "opening_book.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool OpeningBook::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BookHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+
+    const BookHeader* header = (const BookHeader*)mem;
+    if (memcmp(header->magic, BOOK_MAGIC, 8) != 0
+        || sizeof(BookHeader) + header->count * sizeof(BookEntry) > (size_t)st.st_size) {
+        munmap(mem, st.st_size);
+        return false;
+    }
+
+    base = mem;
+    size = st.st_size;
+    entries = (const BookEntry*)((const char*)mem + sizeof(BookHeader));
+    count = header->count;
+    return true;
+}
+
+void OpeningBook::close() {
+    if (base) {
+        munmap(base, size);
+    }
+    base = NULL;
+    size = 0;
+    entries = NULL;
+    count = 0;
+}
+
+static bool entry_key_less(const BookEntry& e, uint64_t key) {
+    return e.key < key;
+}
+
+static bool entry_more_games(const BookEntry& a, const BookEntry& b) {
+    return book_games(a) > book_games(b);
+}
+
+int OpeningBook::probe(uint64_t key, BookEntry* out, int max_entries) const {
+    if (!entries || max_entries <= 0) {
+        return 0;
+    }
+    const BookEntry* first = std::lower_bound(entries, entries + count, key, entry_key_less);
+    const BookEntry* last = first;
+    while (last < entries + count && last->key == key) {
+        last++;
+    }
+
+    int n = std::min<long>(last - first, max_entries);
+    std::partial_sort_copy(first, last, out, out + n, entry_more_games);
+    return n;
+}
@@ -0,0 +1,67 @@
+#include "packed_position.h"
+#include "zobrist.h"
+#include <cstring>
+
+void pack_position(const Position& pos, int score, int result, PackedPosition& out) {
+    memset(&out, 0, sizeof(out));
+    out.occupancy = pos.occupied();
+    Bitboard occ = out.occupancy;
+    int index = 0;
+    // 本项目规则没有升变，棋子不会超过 32 个，16 字节正好够用
+    while (occ && index < 32) {
+        int piece = pos.squares[pop_lsb(occ)];
+        int nibble = piece > 0 ? piece : 8 - piece;
+        out.pieces[index >> 1] |= nibble << ((index & 1) * 4);
+        index++;
+    }
+    out.score = (int16_t)score;
+    out.side = (int8_t)pos.side;
+    out.result = (int8_t)result;
+}
+
+void unpack_position(const PackedPosition& in, Position& pos) {
+    pos.clear();
+    Bitboard occ = in.occupancy;
+    int index = 0;
+    while (occ && index < 32) {
+        pos.put_piece(pop_lsb(occ), packed_piece(in, index++));
+    }
+    pos.side = in.side < 0 ? -1 : 1;
+    if (pos.side < 0) {
+        pos.key ^= zobrist_side;
+    }
+}
+
+bool PackedWriter::open(const char* path, bool append) {
+    close();
+    file = fopen(path, append ? "ab" : "wb");
+    count = 0;
+    total = 0;
+    return file != NULL;
+}
+
+bool PackedWriter::write(const PackedPosition& record) {
+    buffer[count++] = record;
+    total++;
+    if (count == PACKED_WRITER_BUFFER) {
+        return flush();
+    }
+    return true;
+}
+
+bool PackedWriter::flush() {
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(buffer, sizeof(PackedPosition), count, file) == count;
+    count = 0;
+    return fflush(file) == 0 && ok;
+}
+
+void PackedWriter::close() {
+    if (file) {
+        flush();
+        fclose(file);
+        file = NULL;
+    }
+}
@@ -0,0 +1,90 @@
+#include "pawns.h"
+#include "piece.h"
+#include <cstring>
+
+#define DOUBLED_PENALTY  12
+#define ISOLATED_PENALTY 15
+#define BACKWARD_PENALTY 10
+
+#define FILE_A_MASK 0x0101010101010101ULL
+
+// 通路兵按前进的行数加分（从己方底线算起）
+static const int passed_bonus[8] = {0, 5, 10, 20, 35, 60, 100, 0};
+
+static Bitboard file_mask(int x) {
+    return FILE_A_MASK << x;
+}
+
+static Bitboard adjacent_files(int x) {
+    Bitboard mask = 0;
+    if (x > 0) mask |= file_mask(x - 1);
+    if (x < 7) mask |= file_mask(x + 1);
+    return mask;
+}
+
+// 行号小于 y 的所有格子（白方的前方）
+static Bitboard rows_above(int y) {
+    return (1ULL << (y * 8)) - 1;
+}
+
+// 行号大于 y 的所有格子（黑方的前方）
+static Bitboard rows_below(int y) {
+    return y >= 7 ? 0 : ~((1ULL << ((y + 1) * 8)) - 1);
+}
+
+// side 一方的兵形分，越大越好
+static int side_pawn_score(Bitboard own, Bitboard enemy, int side) {
+    int score = 0;
+    for (int x = 0; x < 8; x++) {
+        int count = popcount(own & file_mask(x));
+        if (count > 1) {
+            score -= DOUBLED_PENALTY * (count - 1);
+        }
+    }
+
+    Bitboard pawns = own;
+    while (pawns) {
+        int sq = pop_lsb(pawns);
+        int y = SQ_Y(sq), x = SQ_X(sq);
+        Bitboard front = side == 1 ? rows_above(y) : rows_below(y);
+        Bitboard neighbours = own & adjacent_files(x);
+
+        if ((enemy & front & (file_mask(x) | adjacent_files(x))) == 0) {
+            score += passed_bonus[side == 1 ? 7 - y : y];
+        }
+
+        if (neighbours == 0) {
+            score -= ISOLATED_PENALTY;
+            continue;
+        }
+
+        // 相邻列没有与它平齐或在它后方的己方兵，且前进一格会被对方兵攻击
+        int stop = sq - 8 * side;
+        if (stop >= 0 && stop < 64 && (neighbours & ~front) == 0
+            && (pawn_attacks[color_index(side)][stop] & enemy)) {
+            score -= BACKWARD_PENALTY;
+        }
+    }
+    return score;
+}
+
+int evaluate_pawns(const Position& pos) {
+    Bitboard white = pos.pieces(1, PAWN);
+    Bitboard black = pos.pieces(-1, PAWN);
+    return side_pawn_score(white, black, 1) - side_pawn_score(black, white, -1);
+}
+
+PawnTable::PawnTable() {
+    memset(entries, 0, sizeof(entries));
+    // 没有兵时 pawn_key 为 0，兵形分也为 0，与清零后的表项一致
+}
+
+int PawnTable::probe(const Position& pos) {
+    PawnEntry& e = entries[pos.pawn_key & (PAWN_TABLE_SIZE - 1)];
+    if (e.key == pos.pawn_key) {
+        return e.score;
+    }
+    e.key = pos.pawn_key;
+    e.score = evaluate_pawns(pos);
+    return e.score;
+}
@@ -0,0 +1,243 @@
+#include "pgn.h"
+#include "piece.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+bool PgnReader::open(const char* path) {
+    close();
+    file = fopen(path, "rb");
+    pos = len = 0;
+    pending.clear();
+    return file != NULL;
+}
+
+void PgnReader::close() {
+    if (file) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+bool PgnReader::read_line(std::string& line) {
+    line.clear();
+    while (true) {
+        if (pos >= len) {
+            len = file ? fread(buffer, 1, sizeof(buffer), file) : 0;
+            pos = 0;
+            if (len == 0) {
+                return !line.empty();
+            }
+        }
+        char* start = buffer + pos;
+        char* nl = (char*)memchr(start, '\n', len - pos);
+        if (nl) {
+            line.append(start, nl - start);
+            pos = nl - buffer + 1;
+            if (!line.empty() && line[line.size() - 1] == '\r') {
+                line.erase(line.size() - 1);
+            }
+            return true;
+        }
+        line.append(start, len - pos);
+        pos = len;
+    }
+}
+
+static int parse_result(const std::string& text) {
+    if (text.find("1-0") != std::string::npos) return RESULT_WHITE_WIN;
+    if (text.find("0-1") != std::string::npos) return RESULT_BLACK_WIN;
+    if (text.find("1/2") != std::string::npos) return RESULT_DRAW;
+    return RESULT_UNKNOWN;
+}
+
+bool PgnReader::next_game(PgnGame& game) {
+    game.result = RESULT_UNKNOWN;
+    game.movetext.clear();
+
+    bool in_moves = false;
+    bool any = false;
+    std::string line;
+    if (!pending.empty()) {
+        line.swap(pending);
+    } else if (!read_line(line)) {
+        return false;
+    }
+
+    do {
+        if (!line.empty() && line[0] == '[') {
+            // 棋谱正文之后再次出现标签，说明下一盘棋开始了
+            if (in_moves) {
+                pending.swap(line);
+                return true;
+            }
+            if (line.compare(0, 7, "[Result") == 0) {
+                game.result = parse_result(line);
+            }
+            any = true;
+        } else if (!line.empty() && line[0] != '%') {
+            // 分号注释一直持续到行尾
+            size_t comment = line.find(';');
+            if (comment != std::string::npos) {
+                line.erase(comment);
+            }
+            in_moves = true;
+            any = true;
+            game.movetext += line;
+            game.movetext += ' ';
+        }
+    } while (read_line(line));
+
+    return any;
+}
+
+static int piece_from_letter(char c) {
+    switch (c) {
+        case 'N': return KNIGHT;
+        case 'B': return BISHOP;
+        case 'R': return ROOK;
+        case 'Q': return QUEEN;
+        case 'K': return KING;
+        default: return EMPTY;
+    }
+}
+
+// 王车易位：王在 e 线原位，同侧的车在角上，两者之间没有棋子；否则返回 MOVE_NONE
+static MoveCode parse_castle(const Position& pos, bool queen_side) {
+    int back_rank = pos.side > 0 ? 7 : 0;
+    int king = SQ(back_rank, 4);
+    int rook = SQ(back_rank, queen_side ? 0 : 7);
+    if (pos.squares[king] != KING * pos.side || pos.squares[rook] != ROOK * pos.side) {
+        return MOVE_NONE;
+    }
+    for (int sq = (queen_side ? rook : king) + 1; sq < (queen_side ? king : rook); sq++) {
+        if (pos.squares[sq] != EMPTY) {
+            return MOVE_NONE;
+        }
+    }
+    return encode_move(king, SQ(back_rank, queen_side ? 2 : 6));
+}
+
+MoveCode parse_san(Position& pos, const char* san) {
+    if (strncmp(san, "O-O-O", 5) == 0 || strncmp(san, "0-0-0", 5) == 0) {
+        return parse_castle(pos, true);
+    }
+    if (strncmp(san, "O-O", 3) == 0 || strncmp(san, "0-0", 3) == 0) {
+        return parse_castle(pos, false);
+    }
+
+    int type = PAWN;
+    const char* p = san;
+    if (piece_from_letter(*p) != EMPTY) {
+        type = piece_from_letter(*p++);
+    }
+
+    // 收集所有坐标字符，最后一对为终点，之前的为消歧义信息
+    int files[3], ranks[3], nf = 0, nr = 0;
+    int promo = 0;
+    for (; *p && !isspace((unsigned char)*p); p++) {
+        if (*p >= 'a' && *p <= 'h' && nf < 3) {
+            files[nf++] = *p - 'a';
+        } else if (*p >= '1' && *p <= '8' && nr < 3) {
+            ranks[nr++] = '8' - *p;
+        } else if (*p == '=' && piece_from_letter(p[1]) != EMPTY) {
+            promo = piece_from_letter(*++p);
+        } else if (piece_from_letter(*p) != EMPTY && type == PAWN && nf > 0 && nr > 0) {
+            promo = piece_from_letter(*p); // 例如 e8Q
+        }
+    }
+    if (nf == 0 || nr == 0) {
+        return MOVE_NONE;
+    }
+    int to = SQ(ranks[nr - 1], files[nf - 1]);
+    int from_file = nf > 1 ? files[0] : -1;
+    int from_rank = nr > 1 ? ranks[0] : -1;
+
+    MoveCode moves[MAX_MOVES];
+    int count = generate_legal_moves(pos, moves);
+    for (int i = 0; i < count; i++) {
+        int from = move_from(moves[i]);
+        if (move_to(moves[i]) != to || abs(pos.squares[from]) != type) continue;
+        if (from_file >= 0 && SQ_X(from) != from_file) continue;
+        if (from_rank >= 0 && SQ_Y(from) != from_rank) continue;
+        return encode_move(from, to, promo);
+    }
+
+    // 吃过路兵：兵斜走到空格，本项目的走法生成不包含这种走法
+    if (type == PAWN && from_file >= 0 && pos.squares[to] == EMPTY) {
+        int from = to + (pos.side > 0 ? 8 : -8) + from_file - SQ_X(to);
+        if (from >= 0 && from < 64 && pos.squares[from] == PAWN * pos.side) {
+            return encode_move(from, to);
+        }
+    }
+    return MOVE_NONE;
+}
+
+void apply_pgn_move(Position& pos, MoveCode m) {
+    int from = move_from(m), to = move_to(m);
+    int piece = pos.squares[from];
+
+    if (abs(piece) == KING && abs(SQ_X(to) - SQ_X(from)) == 2) {
+        // 王车易位：先移动车，王的移动交给 do_move；parse_castle 已确认车在角上
+        int rook_from = SQ_X(to) > SQ_X(from) ? to + 1 : to - 2;
+        int rook_to = SQ_X(to) > SQ_X(from) ? to - 1 : to + 1;
+        int rook = pos.squares[rook_from];
+        if (abs(rook) == ROOK) {
+            pos.remove_piece(rook_from);
+            pos.put_piece(rook_to, rook);
+        }
+    } else if (abs(piece) == PAWN && SQ_X(from) != SQ_X(to) && pos.squares[to] == EMPTY) {
+        pos.remove_piece(SQ(SQ_Y(from), SQ_X(to)));
+    }
+
+    Undo undo;
+    pos.do_move(m, undo);
+}
+
+static const char* skip_token(const char* p) {
+    while (*p && !isspace((unsigned char)*p) && *p != '(' && *p != ')' && *p != '{') p++;
+    return p;
+}
+
+int pgn_replay(const std::string& movetext, int max_ply, PgnPly* plies) {
+    Position pos;
+    pos.set_board(initialBoard, 1);
+
+    const char* p = movetext.c_str();
+    int ply = 0;
+    int depth = 0; // 变着括号嵌套层数
+    while (*p && ply < max_ply) {
+        char c = *p;
+        if (isspace((unsigned char)c) || c == '.') {
+            p++;
+        } else if (c == '{') {
+            const char* end = strchr(p, '}');
+            if (!end) break;
+            p = end + 1;
+        } else if (c == '(') {
+            depth++;
+            p++;
+        } else if (c == ')') {
+            depth--;
+            p++;
+        } else if (depth > 0 || c == '$' || c == ';') {
+            // 变着与注释符号
+            p = skip_token(p + 1);
+        } else if (c == '*' || strncmp(p, "1-0", 3) == 0 || strncmp(p, "0-1", 3) == 0
+                   || strncmp(p, "1/2", 3) == 0) {
+            break;
+        } else if (isdigit((unsigned char)c) && strncmp(p, "0-0", 3) != 0) {
+            // 回合编号，例如 "12." 或 "12..."
+            while (isdigit((unsigned char)*p)) p++;
+        } else {
+            MoveCode m = parse_san(pos, p);
+            if (m == MOVE_NONE) break;
+            plies[ply].key = pos.key;
+            plies[ply].move = m;
+            ply++;
+            apply_pgn_move(pos, m);
+            p = skip_token(p);
+        }
+    }
+    return ply;
+}
@@ -1,4 +1,5 @@
 #include "piece.h"
+#include "position.h"
 #include <cstdlib>
 #include <ncurses.h>
 
@@ -28,16 +29,41 @@ bool is_in_board(int y, int x) {
     return y >= 0 && y < 8 && x >= 0 && x < 8;
 }
 
-// 棋子分值定义
-int get_piece_value(int piece) {
-    switch (abs(piece)) {
-        case 1: return 10;  // 兵
-        case 2: return 30;  // 马
-        case 3: return 30;  // 象
-        case 4: return 50;  // 车
-        case 5: return 90;  // 后
-        case 6: return 900; // 王
-        default: return 0;
+// 方向数组使用 bitboard.h 中编译期定义的表：0..3 为斜线，4..7 为直线
+#define DIAGONAL_FIRST 0
+#define STRAIGHT_FIRST 4
+
+// 兵的走法按颜色分别实例化：前进方向、初始行和对方棋子的符号都在编译期确定
+template <int Side>
+static void predict_pawn_move(int y, int x, std::vector<std::vector<int>>& predicted_moves) {
+    constexpr int forward = Side > 0 ? -1 : 1;
+    // 初始位置可以前进两步
+    if (is_in_board(y + 2 * forward, x) && try_move(y, x, y + 2 * forward, x)) {
+        predicted_moves[y + 2 * forward][x] = PREDICTED_MOVE;
+    }
+    for (int dx = -1; dx <= 1; dx++) {
+        if (is_in_board(y + forward, x + dx) && try_move(y, x, y + forward, x + dx)) {
+            predicted_moves[y + forward][x + dx] = PREDICTED_MOVE;
+        }
+    }
+}
+
+// 沿 first..last 方向滑动或跳一步（step_only）
+static void predict_directions(int y, int x, int first, int last, bool step_only,
+                               std::vector<std::vector<int>>& predicted_moves) {
+    for (int i = first; i <= last; i++) {
+        int ny = y + direction_dy[i];
+        int nx = x + direction_dx[i];
+        while (is_in_board(ny, nx)) {
+            if (try_move(y, x, ny, nx)) {
+                predicted_moves[ny][nx] = PREDICTED_MOVE;
+            }
+            if (step_only || board[ny][nx] != EMPTY) {
+                break;
+            }
+            ny += direction_dy[i];
+            nx += direction_dx[i];
+        }
     }
 }
 
@@ -46,238 +72,83 @@ void predict_move(int y, int x, std::vector<std::vector<int>>& predicted_moves)
     switch (std::abs(piece_val)) {
         // 兵只能前进一步，不能后退
         // 如果小兵的左上和右上有棋子，则可以吃对方棋子
-        case PAWN: {
+        case PAWN:
             if (piece_val > 0) {
-                // 初始位置可以前进两步
-                if (is_in_board(y - 2, x) && try_move(y, x, y - 2, x)) {
-                    predicted_moves[y - 2][x] = PREDICTED_MOVE;
-                }
-                if (is_in_board(y - 1, x) && try_move(y, x, y - 1, x)) {
-                    predicted_moves[y - 1][x] = PREDICTED_MOVE;
-                }
-                if (is_in_board(y - 1, x - 1) && try_move(y, x, y - 1, x - 1)) {
-                    predicted_moves[y - 1][x - 1] = PREDICTED_MOVE;
-                }
-                if (is_in_board(y - 1, x + 1) && try_move(y, x, y - 1, x + 1)) {
-                    predicted_moves[y - 1][x + 1] = PREDICTED_MOVE;
-                }
+                predict_pawn_move<1>(y, x, predicted_moves);
             } else {
-                if (is_in_board(y + 2, x) && try_move(y, x, y + 2, x)) {
-                    predicted_moves[y + 2][x] = PREDICTED_MOVE;
-                }
-                if (is_in_board(y + 1, x) && try_move(y, x, y + 1, x)) {
-                    predicted_moves[y + 1][x] = PREDICTED_MOVE;
-                }
-                if (is_in_board(y + 1, x - 1) && try_move(y, x, y + 1, x - 1)) {
-                    predicted_moves[y + 1][x - 1] = PREDICTED_MOVE;
-                }
-                if (is_in_board(y + 1, x + 1) && try_move(y, x, y + 1, x + 1)) {
-                    predicted_moves[y + 1][x + 1] = PREDICTED_MOVE;
-                }
+                predict_pawn_move<-1>(y, x, predicted_moves);
             }
             break;
-        }
-        case KNIGHT: {
-            int dy[] = {-2, -2, -1, -1,  1,  1,  2,  2};
-            int dx[] = {-1,  1, -2,  2, -2,  2, -1,  1};
+        case KNIGHT:
             for (int i = 0; i < 8; i++) {
-                int ny = y + dy[i];
-                int nx = x + dx[i];
+                int ny = y + knight_dy[i];
+                int nx = x + knight_dx[i];
                 if (is_in_board(ny, nx) && try_move(y, x, ny, nx)) {
                     predicted_moves[ny][nx] = PREDICTED_MOVE;
                 }
             }
             break;
+        case BISHOP: predict_directions(y, x, DIAGONAL_FIRST, DIAGONAL_FIRST + 3, false, predicted_moves); break;
+        case ROOK:   predict_directions(y, x, STRAIGHT_FIRST, STRAIGHT_FIRST + 3, false, predicted_moves); break;
+        case QUEEN:  predict_directions(y, x, 0, 7, false, predicted_moves); break;
+        case KING:   predict_directions(y, x, 0, 7, true, predicted_moves); break;
+    }
+}
+
+// 兵只能前进一步，初始位置可以前进两步；斜前方有对方棋子时可以吃子
+template <int Side>
+static bool is_legal_pawn_move(int from_y, int from_x, int to_y, int to_x) {
+    constexpr int forward = Side > 0 ? -1 : 1;
+    constexpr int start_row = Side > 0 ? 6 : 1;
+    if (to_y == from_y + forward) {
+        if (to_x == from_x) {
+            return board[to_y][to_x] == EMPTY;
         }
-        case BISHOP: {
-            int dy[] = {-1, -1,  1,  1};
-            int dx[] = {-1,  1, -1,  1};
-            for (int i = 0; i < 4; i++) {
-                int ny = y + dy[i];
-                int nx = x + dx[i];
-                while (is_in_board(ny, nx)) {
-                    if (try_move(y, x, ny, nx)) {
-                        predicted_moves[ny][nx] = PREDICTED_MOVE;
-                    }
-                    if (board[ny][nx] != EMPTY) {
-                        break;
-                    }
-                    ny += dy[i];
-                    nx += dx[i];
-                }
-            }
-            break;
-        }
-        case ROOK: {
-            int dy[] = {-1,  0,  1,  0};
-            int dx[] = { 0,  1,  0, -1};
-            for (int i = 0; i < 4; i++) {
-                int ny = y + dy[i];
-                int nx = x + dx[i];
-                while (is_in_board(ny, nx)) {
-                    if (try_move(y, x, ny, nx)) {
-                        predicted_moves[ny][nx] = PREDICTED_MOVE;
-                    }
-                    if (board[ny][nx] != EMPTY) {
-                        break;
-                    }
-                    ny += dy[i];
-                    nx += dx[i];
-                }
-            }
-            break;
-        }
-        case QUEEN: {
-            int dy[] = {-1, -1,  0,  1,  1,  1,  0, -1};
-            int dx[] = { 0,  1,  1,  1,  0, -1, -1, -1};
-            for (int i = 0; i < 8; i++) {
-                int ny = y + dy[i];
-                int nx = x + dx[i];
-                while (is_in_board(ny, nx)) {
-                    if (try_move(y, x, ny, nx)) {
-                        predicted_moves[ny][nx] = PREDICTED_MOVE;
-                    }
-                    if (board[ny][nx] != EMPTY) {
-                        break;
-                    }
-                    ny += dy[i];
-                    nx += dx[i];
-                }
+        return (to_x == from_x - 1 || to_x == from_x + 1) && board[to_y][to_x] * Side < 0;
+    }
+    return from_y == start_row && to_y == from_y + 2 * forward && from_x == to_x
+        && board[from_y + forward][from_x] == EMPTY && board[to_y][to_x] == EMPTY;
+}
+
+// 沿 first..last 方向能否走到目标格，途中不能越子，目标格不能是己方棋子
+static bool reaches_along(int from_y, int from_x, int to_y, int to_x, int first, int last, bool step_only) {
+    int piece_val = board[from_y][from_x];
+    for (int i = first; i <= last; i++) {
+        int ny = from_y + direction_dy[i];
+        int nx = from_x + direction_dx[i];
+        while (is_in_board(ny, nx) && piece_val * board[ny][nx] <= 0) {
+            if (ny == to_y && nx == to_x) {
+                return true;
             }
-            break;
-        }
-        case KING: {
-            int dy[] = {-1, -1,  0,  1,  1,  1,  0, -1};
-            int dx[] = { 0,  1,  1,  1,  0, -1, -1, -1};
-            for (int i = 0; i < 8; i++) {
-                int ny = y + dy[i];
-                int nx = x + dx[i];
-                if (is_in_board(ny, nx) && try_move(y, x, ny, nx)) {
-                    predicted_moves[ny][nx] = PREDICTED_MOVE;
-                }
+            if (step_only || board[ny][nx] != EMPTY) {
+                break;
             }
-            break;
+            ny += direction_dy[i];
+            nx += direction_dx[i];
         }
     }
+    return false;
 }
 
 bool is_legal_move(int from_y, int from_x, int to_y, int to_x) {
     int piece_val = board[from_y][from_x];
     switch (std::abs(piece_val)) {
-        case PAWN: {
-            // 兵只能前进一步，不能后退
-            // 如果小兵的左上和右上有棋子，则可以吃对方棋子
-            if (piece_val > 0) {
-                // 初始位置可以前进两步
-                if (from_y == 6 && to_y == 4 && from_x == to_x && board[from_y - 1][from_x] == EMPTY && board[to_y][to_x] == EMPTY) {
-                    return true;
-                }
-                if (from_y > 0 && to_y == from_y - 1 && from_x == to_x && board[to_y][to_x] == EMPTY) {
-                    return true;
-                }
-                if (from_x > 0 && to_y == from_y - 1 && to_x == from_x - 1 && board[to_y][to_x] < 0) {
-                    return true;
-                }
-                if (from_x < 7 && to_y == from_y - 1 && to_x == from_x + 1 && board[to_y][to_x] < 0) {
-                    return true;
-                }
-            } else {
-                if (from_y == 1 && to_y == 3 && from_x == to_x && board[from_y + 1][from_x] == EMPTY && board[to_y][to_x] == EMPTY) {
-                    return true;
-                }
-                if (from_y < 7 && to_y == from_y + 1 && from_x == to_x && board[to_y][to_x] == EMPTY) {
-                    return true;
-                }
-                if (from_x > 0 && to_y == from_y + 1 && to_x == from_x - 1 && board[to_y][to_x] > 0) {
-                    return true;
-                }
-                if (from_x < 7 && to_y == from_y + 1 && to_x == from_x + 1 && board[to_y][to_x] > 0) {
-                    return true;
-                }
-            }
-            break;
-        }
-        case KNIGHT: {
-            int dy[] = {-2, -2, -1, -1,  1,  1,  2,  2};
-            int dx[] = {-1,  1, -2,  2, -2,  2, -1,  1};
+        case PAWN:
+            return piece_val > 0 ? is_legal_pawn_move<1>(from_y, from_x, to_y, to_x)
+                                 : is_legal_pawn_move<-1>(from_y, from_x, to_y, to_x);
+        case KNIGHT:
             for (int i = 0; i < 8; i++) {
-                int ny = from_y + dy[i];
-                int nx = from_x + dx[i];
+                int ny = from_y + knight_dy[i];
+                int nx = from_x + knight_dx[i];
                 if (is_in_board(ny, nx) && ny == to_y && nx == to_x && piece_val * board[ny][nx] <= 0) {
                     return true;
                 }
             }
             break;
-        }
-        case BISHOP: {
-            int dy[] = {-1, -1,  1,  1};
-            int dx[] = {-1,  1, -1,  1};
-            for (int i = 0; i < 4; i++) {
-                int ny = from_y + dy[i];
-                int nx = from_x + dx[i];
-                while (is_in_board(ny, nx) && piece_val * board[ny][nx] <= 0) {
-                    if (ny == to_y && nx == to_x) {
-                        return true;
-                    }
-                    if (board[ny][nx] != EMPTY) {
-                        break;
-                    }
-                    ny += dy[i];
-                    nx += dx[i];
-                }
-            }
-            break;
-        }
-        case ROOK: {
-            int dy[] = {-1,  0,  1,  0};
-            int dx[] = { 0,  1,  0, -1};
-            for (int i = 0; i < 4; i++) {
-                int ny = from_y + dy[i];
-                int nx = from_x + dx[i];
-                while (is_in_board(ny, nx) && piece_val * board[ny][nx] <= 0) {
-                    if (ny == to_y && nx == to_x) {
-                        return true;
-                    }
-                    if (board[ny][nx] != EMPTY) {
-                        break;
-                    }
-                    ny += dy[i];
-                    nx += dx[i];
-                }
-            }
-            break;
-        }
-        case QUEEN: {
-            int dy[] = {-1, -1,  0,  1,  1,  1,  0, -1};
-            int dx[] = { 0,  1,  1,  1,  0, -1, -1, -1};
-            for (int i = 0; i < 8; i++) {
-                int ny = from_y + dy[i];
-                int nx = from_x + dx[i];
-                while (is_in_board(ny, nx) && piece_val * board[ny][nx] <= 0) {
-                    if (ny == to_y && nx == to_x) {
-                        return true;
-                    }
-                    if (board[ny][nx] != EMPTY) {
-                        break;
-                    }
-                    ny += dy[i];
-                    nx += dx[i];
-                }
-            }
-            break;
-        }
-        case KING: {
-            int dy[] = {-1, -1,  0,  1,  1,  1,  0, -1};
-            int dx[] = { 0,  1,  1,  1,  0, -1, -1, -1};
-            for (int i = 0; i < 8; i++) {
-                int ny = from_y + dy[i];
-                int nx = from_x + dx[i];
-                if (is_in_board(ny, nx) && ny == to_y && nx == to_x && piece_val * board[ny][nx] <= 0) {
-                    return true;
-                }
-            }
-            break;
-        }
+        case BISHOP: return reaches_along(from_y, from_x, to_y, to_x, DIAGONAL_FIRST, DIAGONAL_FIRST + 3, false);
+        case ROOK:   return reaches_along(from_y, from_x, to_y, to_x, STRAIGHT_FIRST, STRAIGHT_FIRST + 3, false);
+        case QUEEN:  return reaches_along(from_y, from_x, to_y, to_x, 0, 7, false);
+        case KING:   return reaches_along(from_y, from_x, to_y, to_x, 0, 7, true);
     }
     return false;
 }
@@ -344,34 +215,8 @@ bool try_move(int sy, int sx, int dy, int dx) {
 }
 
 bool is_checkmate(int side) {
-    // 1. 如果当前没有被将军，那肯定不是将死
-    if (!is_in_check(side)) {
-        return false;
-    }
-
-    // 2. 遍历棋盘上所有属于 side 方的棋子
-    for (int sy = 0; sy < 8; sy++) {
-        for (int sx = 0; sx < 8; sx++) {
-            if (board[sy][sx] * side > 0) { 
-                
-                // 3. 尝试这个棋子可以移动到的所有目标位置
-                for (int dy = 0; dy < 8; dy++) {
-                    for (int dx = 0; dx < 8; dx++) {
-                        // 跳过自己的位置
-                        if (dy == sy && dx == sx) continue;
-                        
-                        // 4. 使用之前提到的 try_move 逻辑
-                        // try_move 内部会模拟移动并检查是否依然被将军
-                        if (try_move(sy, sx, dy, dx)) {
-                            // 只要找到任何一个移动能解除将军，就不是将死
-                            return false; 
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    // 5. 找遍了所有棋子的所有走法都无法解围，判定为将死
-    return true;
-}
\ No newline at end of file
+    // 只在被将军时生成应将走法，不再逐个尝试 64×64 种移动
+    Position pos;
+    pos.set_board(board, side);
+    return position_status(pos) == STATUS_CHECKMATE;
+}
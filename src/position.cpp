@@ -0,0 +1,356 @@
+#include "position.h"
+#include "piece.h"
+#include "zobrist.h"
+#include <cstdlib>
+#include <cstring>
+
+void move_to_string(MoveCode m, char* buf) {
+    static const char promo_letters[] = " pnbrqk";
+    int from = move_from(m), to = move_to(m);
+    buf[0] = 'a' + SQ_X(from);
+    buf[1] = '8' - SQ_Y(from);
+    buf[2] = 'a' + SQ_X(to);
+    buf[3] = '8' - SQ_Y(to);
+    buf[4] = move_promo(m) ? promo_letters[move_promo(m)] : '\0';
+    buf[5] = '\0';
+}
+
+void Position::clear() {
+    memset(squares, 0, sizeof(squares));
+    memset(by_color, 0, sizeof(by_color));
+    memset(by_type, 0, sizeof(by_type));
+    king_sq[0] = king_sq[1] = -1;
+    side = 1;
+    key = 0;
+    pawn_key = 0;
+}
+
+void Position::set_board(const int b[8][8], int side_to_move) {
+    clear();
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            if (b[i][j] != EMPTY) {
+                put_piece(SQ(i, j), b[i][j]);
+            }
+        }
+    }
+    side = side_to_move;
+    if (side < 0) {
+        key ^= zobrist_side;
+    }
+}
+
+void Position::to_board(int b[8][8]) const {
+    for (int sq = 0; sq < 64; sq++) {
+        b[SQ_Y(sq)][SQ_X(sq)] = squares[sq];
+    }
+}
+
+static int piece_from_fen(char c) {
+    static const char letters[] = " pnbrqk";
+    const char* p = strchr(letters, c | 0x20);
+    if (c == ' ' || !p) {
+        return EMPTY;
+    }
+    int type = (int)(p - letters);
+    return (c & 0x20) ? -type : type;
+}
+
+bool Position::set_fen(const char* fen) {
+    clear();
+    int y = 0, x = 0;
+    const char* p = fen;
+    for (; *p && *p != ' '; p++) {
+        if (*p == '/') {
+            y++;
+            x = 0;
+        } else if (*p >= '1' && *p <= '8') {
+            x += *p - '0';
+        } else {
+            int piece = piece_from_fen(*p);
+            if (piece == EMPTY || y > 7 || x > 7) {
+                return false;
+            }
+            put_piece(SQ(y, x), piece);
+            x++;
+        }
+    }
+    if (y != 7 || king_sq[0] < 0 || king_sq[1] < 0) {
+        return false;
+    }
+    while (*p == ' ') p++;
+    side = *p == 'b' ? -1 : 1;
+    if (side < 0) {
+        key ^= zobrist_side;
+    }
+    return true;
+}
+
+bool Position::set_fen_strict(const char* fen) {
+    int ranks = 1, files = 0;
+    for (const char* p = fen; *p && *p != ' '; p++) {
+        if (*p == '/') {
+            if (files != 8) {
+                return false;
+            }
+            ranks++;
+            files = 0;
+        } else {
+            files += *p >= '1' && *p <= '8' ? *p - '0' : 1;
+        }
+    }
+    if (ranks != 8 || files != 8 || !set_fen(fen)) {
+        return false;
+    }
+    return popcount(pieces(1, KING)) == 1 && popcount(pieces(-1, KING)) == 1 && !in_check(-side);
+}
+
+void Position::to_fen(char* buf) const {
+    static const char letters[] = " PNBRQK";
+    char* out = buf;
+    for (int y = 0; y < 8; y++) {
+        int empty = 0;
+        for (int x = 0; x < 8; x++) {
+            int piece = squares[SQ(y, x)];
+            if (piece == EMPTY) {
+                empty++;
+                continue;
+            }
+            if (empty) {
+                *out++ = '0' + empty;
+                empty = 0;
+            }
+            char c = letters[abs(piece)];
+            *out++ = piece > 0 ? c : (char)(c | 0x20);
+        }
+        if (empty) *out++ = '0' + empty;
+        if (y < 7) *out++ = '/';
+    }
+    strcpy(out, side > 0 ? " w - - 0 1" : " b - - 0 1");
+}
+
+void Position::put_piece(int sq, int piece) {
+    int c = color_index(piece);
+    squares[sq] = piece;
+    by_color[c] |= BIT(sq);
+    by_type[abs(piece)] |= BIT(sq);
+    if (abs(piece) == KING) {
+        king_sq[c] = sq;
+    }
+    key ^= zobrist_piece(piece, sq);
+    if (abs(piece) == PAWN) {
+        pawn_key ^= zobrist_piece(piece, sq);
+    }
+}
+
+void Position::remove_piece(int sq) {
+    int piece = squares[sq];
+    squares[sq] = EMPTY;
+    by_color[color_index(piece)] &= ~BIT(sq);
+    by_type[abs(piece)] &= ~BIT(sq);
+    key ^= zobrist_piece(piece, sq);
+    if (abs(piece) == PAWN) {
+        pawn_key ^= zobrist_piece(piece, sq);
+    }
+}
+
+void Position::do_move(MoveCode m, Undo& undo) {
+    int from = move_from(m), to = move_to(m);
+    undo.move = m;
+    undo.moved = squares[from];
+    undo.captured = squares[to];
+    undo.key = key;
+    undo.pawn_key = pawn_key;
+
+    if (undo.captured != EMPTY) {
+        remove_piece(to);
+    }
+    remove_piece(from);
+    put_piece(to, move_promo(m) ? move_promo(m) * side : undo.moved);
+
+    side = -side;
+    key ^= zobrist_side;
+}
+
+void Position::undo_move(const Undo& undo) {
+    int from = move_from(undo.move), to = move_to(undo.move);
+    remove_piece(to);
+    put_piece(from, undo.moved);
+    if (undo.captured != EMPTY) {
+        put_piece(to, undo.captured);
+    }
+    side = -side;
+    key = undo.key;
+    pawn_key = undo.pawn_key;
+}
+
+static CPU_KERNEL_INLINE int add_targets(int from, Bitboard targets, MoveCode* list, int n) {
+    while (targets) {
+        list[n++] = encode_move(from, pop_lsb(targets));
+    }
+    return n;
+}
+
+// 生成 pieces 中各棋子走到 allowed 范围内的伪合法走法，按走棋方和指令集分别实例化
+template <int Us, int Isa>
+static CPU_KERNEL_INLINE int generate_side_moves(const Position& pos, Bitboard pieces, Bitboard allowed, MoveCode* list) {
+    // 白兵向 y 减小方向前进，黑兵相反；初始行可以前进两步
+    constexpr int us = Us > 0 ? 0 : 1;
+    constexpr int step = Us > 0 ? -8 : 8;
+    constexpr int start_row = Us > 0 ? 6 : 1;
+    int n = 0;
+    Bitboard own = pos.by_color[us];
+    Bitboard enemy = pos.by_color[us ^ 1];
+    Bitboard occ = own | enemy;
+
+    while (pieces) {
+        int from = pop_lsb(pieces);
+        Bitboard targets = 0;
+        switch (abs(pos.squares[from])) {
+            case PAWN: {
+                int one = from + step;
+                if (one >= 0 && one < 64 && !(occ & BIT(one))) {
+                    targets |= BIT(one);
+                    if (SQ_Y(from) == start_row && !(occ & BIT(one + step))) {
+                        targets |= BIT(one + step);
+                    }
+                }
+                targets |= pawn_attacks[us][from] & enemy;
+                break;
+            }
+            case KNIGHT: targets = knight_attacks[from] & ~own; break;
+            case BISHOP: targets = slider_bishop_attacks<Isa>(from, occ) & ~own; break;
+            case ROOK:   targets = slider_rook_attacks<Isa>(from, occ) & ~own; break;
+            case QUEEN:  targets = (slider_bishop_attacks<Isa>(from, occ) | slider_rook_attacks<Isa>(from, occ)) & ~own; break;
+            case KING:   targets = king_attacks[from] & ~own; break;
+        }
+        n = add_targets(from, targets & allowed, list, n);
+    }
+    return n;
+}
+
+template <int Isa>
+static CPU_KERNEL_INLINE int generate_moves_for(const Position& pos, Bitboard pieces, Bitboard allowed, MoveCode* list) {
+    return pos.side > 0 ? generate_side_moves<1, Isa>(pos, pieces, allowed, list)
+                        : generate_side_moves<-1, Isa>(pos, pieces, allowed, list);
+}
+
+CPU_DISPATCH_TABLE(movegen_kernels, generate_moves_for, int,
+                   (const Position& pos, Bitboard pieces, Bitboard allowed, MoveCode* list),
+                   (pos, pieces, allowed, list));
+
+template <int Isa>
+static CPU_KERNEL_INLINE Bitboard attackers_for(const Position& pos, int sq, int attacker_side, Bitboard occ) {
+    return attacker_side > 0 ? pos.attackers<1, Isa>(sq, occ) : pos.attackers<-1, Isa>(sq, occ);
+}
+
+CPU_DISPATCH_TABLE(attackers_kernels, attackers_for, Bitboard,
+                   (const Position& pos, int sq, int attacker_side, Bitboard occ),
+                   (pos, sq, attacker_side, occ));
+
+static int generate_moves_to(const Position& pos, Bitboard pieces, Bitboard allowed, MoveCode* list) {
+    return cpu_kernels.generate_moves(pos, pieces, allowed, list);
+}
+
+int generate_pseudo_moves(const Position& pos, MoveCode* list) {
+    return generate_moves_to(pos, pos.by_color[color_index(pos.side)], ~0ULL, list);
+}
+
+int generate_captures(const Position& pos, MoveCode* list) {
+    int us = color_index(pos.side);
+    return generate_moves_to(pos, pos.by_color[us], pos.by_color[us ^ 1], list);
+}
+
+static bool is_legal_after(Position& pos, MoveCode m) {
+    Undo undo;
+    int mover = pos.side;
+    pos.do_move(m, undo);
+    bool legal = !pos.in_check(mover);
+    pos.undo_move(undo);
+    return legal;
+}
+
+int generate_legal_moves(Position& pos, MoveCode* list) {
+    if (pos.in_check(pos.side)) {
+        return generate_evasions(pos, list);
+    }
+    MoveCode pseudo[MAX_MOVES];
+    int count = generate_pseudo_moves(pos, pseudo);
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        if (is_legal_after(pos, pseudo[i])) {
+            list[n++] = pseudo[i];
+        }
+    }
+    return n;
+}
+
+int generate_evasions(Position& pos, MoveCode* list) {
+    int us = color_index(pos.side);
+    int ksq = pos.king_sq[us];
+    Bitboard checkers = pos.attackers_to(ksq, -pos.side);
+    int n = 0;
+
+    // 王的移动：把王从占位中拿掉再判断，避免沿将军线后退仍被同一条线攻击
+    Bitboard occ = pos.occupied() ^ BIT(ksq);
+    Bitboard targets = king_attacks[ksq] & ~pos.by_color[us];
+    while (targets) {
+        int to = pop_lsb(targets);
+        if (!pos.attackers_to(to, -pos.side, occ)) {
+            list[n++] = encode_move(ksq, to);
+        }
+    }
+
+    // 双将只能动王
+    if (checkers & (checkers - 1)) {
+        return n;
+    }
+
+    // 吃掉将军的棋子或挡在将军线上，被牵制的棋子仍需检查
+    int checker = lsb(checkers);
+    Bitboard allowed = checkers | between_masks[ksq][checker];
+    MoveCode candidates[MAX_MOVES];
+    int count = generate_moves_to(pos, pos.by_color[us] & ~BIT(ksq), allowed, candidates);
+    for (int i = 0; i < count; i++) {
+        if (is_legal_after(pos, candidates[i])) {
+            list[n++] = candidates[i];
+        }
+    }
+    return n;
+}
+
+bool has_legal_move(Position& pos) {
+    MoveCode moves[MAX_MOVES];
+    if (pos.in_check(pos.side)) {
+        return generate_evasions(pos, moves) > 0;
+    }
+    int count = generate_pseudo_moves(pos, moves);
+    for (int i = 0; i < count; i++) {
+        if (is_legal_after(pos, moves[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int position_status(Position& pos) {
+    bool check = pos.in_check(pos.side);
+    if (has_legal_move(pos)) {
+        return check ? STATUS_CHECK : STATUS_NORMAL;
+    }
+    return check ? STATUS_CHECKMATE : STATUS_STALEMATE;
+}
+
+void StatusCache::clear() {
+    memset(keys, 0, sizeof(keys));
+    memset(status, -1, sizeof(status));
+}
+
+int StatusCache::probe(Position& pos) {
+    int index = pos.key & (STATUS_CACHE_SIZE - 1);
+    if (keys[index] != pos.key || status[index] < 0) {
+        keys[index] = pos.key;
+        status[index] = position_status(pos);
+    }
+    return status[index];
+}
@@ -0,0 +1,668 @@
+#include "search.h"
+#include "alloc_count.h"
+#include "evaluate.h"
+#include "tablebase.h"
+#include "piece.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+// 走法排序分数
+#define ORDER_TT_MOVE  1000000
+#define ORDER_CAPTURE   100000
+#define ORDER_KILLER_1   90000
+#define ORDER_KILLER_2   80000
+// 历史分上限，低于杀手着法，安静着法的排序不会越过杀手和吃子
+#define HISTORY_MAX      16384
+
+// 每层一帧：走法列表、排序分数、主变例、杀手走法和悔棋记录都放在这里。
+// 搜索线程创建时一次分配好整个栈，开始搜索到给出最佳走法之间不再申请内存
+typedef struct {
+    MoveCode moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    MoveCode pv[MAX_PLY];
+    int pv_length;
+    MoveCode killers[2];
+    Undo undo;
+} SearchFrame;
+
+class SearchWorker {
+public:
+    SearchWorker(Engine& engine, int id);
+    ~SearchWorker();
+    void start(const Position& root);
+    void clear_history() { memset(history, 0, sizeof(history)); }
+    // 辅助线程：等待 Engine::search 发出新的搜索，搜完后回到等待
+    void idle_loop(uint64_t seen);
+
+    Engine& engine;
+    int id;
+    SearchCounters& counters() { return engine.counters[id]; }
+    SearchResult result;
+    int completed_depth;
+    int root_moves;              // 根节点合法走法数
+    uint64_t root_best_nodes;    // 本轮最佳走法子树的节点数
+    uint64_t root_total_nodes;
+    SearchResult lines[MAX_MULTIPV];  // 多主变例时每条线的结果，lines[0] 与 result 相同
+    int line_count;
+
+private:
+    int search(int alpha, int beta, int depth, int ply);
+    int qsearch(int alpha, int beta, int ply);
+    int evaluate_noisy();
+    void score_moves(const MoveCode* moves, int* scores, int count, MoveCode tt_move, int ply);
+    void update_pv(int ply, MoveCode move);
+    bool is_excluded(MoveCode move) const;
+
+    Position pos;
+    Evaluator evaluator;
+    SearchFrame* stack;          // MAX_PLY + 1 帧，按 ply 下标
+    int history[64][64];
+    MoveCode root_excluded[MAX_MULTIPV];  // 本轮已经找到的主变例首步，根节点不再搜索
+    int excluded_count;
+};
+
+// 将杀分数按到根节点的距离存取置换表
+static int score_to_tt(int score, int ply) {
+    if (score >= SCORE_MATE_IN_MAX) return score + ply;
+    if (score <= -SCORE_MATE_IN_MAX) return score - ply;
+    return score;
+}
+
+static int score_from_tt(int score, int ply) {
+    if (score >= SCORE_MATE_IN_MAX) return score - ply;
+    if (score <= -SCORE_MATE_IN_MAX) return score + ply;
+    return score;
+}
+
+// 选出剩余走法中分数最高的一个放到 index 处
+static void pick_move(MoveCode* moves, int* scores, int count, int index) {
+    int best = index;
+    for (int i = index + 1; i < count; i++) {
+        if (scores[i] > scores[best]) best = i;
+    }
+    MoveCode m = moves[index]; moves[index] = moves[best]; moves[best] = m;
+    int s = scores[index]; scores[index] = scores[best]; scores[best] = s;
+}
+
+bool SearchWorker::is_excluded(MoveCode move) const {
+    for (int i = 0; i < excluded_count; i++) {
+        if (root_excluded[i] == move) return true;
+    }
+    return false;
+}
+
+int SearchWorker::evaluate_noisy() {
+    int score = evaluator.evaluate(pos);
+    int noise = engine.limits.eval_noise;
+    if (noise > 0) {
+        // 由局面哈希和种子决定的扰动，同一局面在一次搜索中得分一致
+        uint64_t h = (pos.key ^ engine.limits.seed) * 0x9E3779B97F4A7C15ULL;
+        score += (int)((h >> 40) % (uint64_t)(noise * 2 + 1)) - noise;
+    }
+    return score;
+}
+
+void SearchWorker::score_moves(const MoveCode* moves, int* scores, int count, MoveCode tt_move, int ply) {
+    for (int i = 0; i < count; i++) {
+        int from = move_from(moves[i]), to = move_to(moves[i]);
+        if (moves[i] == tt_move) {
+            scores[i] = ORDER_TT_MOVE;
+        } else if (pos.squares[to] != EMPTY) {
+            // MVV-LVA：先吃价值高的，再用价值低的棋子去吃
+            scores[i] = ORDER_CAPTURE + get_piece_value(pos.squares[to]) * 10 - get_piece_value(pos.squares[from]) / 10;
+        } else if (moves[i] == stack[ply].killers[0]) {
+            scores[i] = ORDER_KILLER_1;
+        } else if (moves[i] == stack[ply].killers[1]) {
+            scores[i] = ORDER_KILLER_2;
+        } else {
+            scores[i] = history[from][to];
+        }
+    }
+}
+
+void SearchWorker::update_pv(int ply, MoveCode move) {
+    SearchFrame& frame = stack[ply];
+    const SearchFrame& child = stack[ply + 1];
+    frame.pv[ply] = move;
+    for (int i = ply + 1; i < child.pv_length; i++) {
+        frame.pv[i] = child.pv[i];
+    }
+    frame.pv_length = child.pv_length;
+}
+
+int SearchWorker::qsearch(int alpha, int beta, int ply) {
+    SearchCounters& c = counters();
+    counter_add(c.nodes, 1);
+    STAT_ADD(c, qnodes, 1);
+    STAT_MAX(c, seldepth, ply);
+    SearchFrame& frame = stack[ply];
+    frame.pv_length = ply;
+
+    if (engine.stop.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    if (id == 0 && (c.nodes.load(std::memory_order_relaxed) & 1023) == 0) {
+        engine.check_limits();
+    }
+    if (ply >= MAX_PLY - 1) {
+        return evaluate_noisy();
+    }
+
+    bool in_check = pos.in_check(pos.side);
+    MoveCode* moves = frame.moves;
+    int* scores = frame.scores;
+    int count;
+    int best = -SCORE_INF;
+    if (in_check) {
+        // 被将军时所有应将走法都要搜索，否则会漏掉将杀
+        count = generate_evasions(pos, moves);
+        if (count == 0) {
+            return -SCORE_MATE + ply;
+        }
+    } else {
+        best = evaluate_noisy();
+        if (best >= beta) {
+            return best;
+        }
+        if (best > alpha) {
+            alpha = best;
+        }
+        count = generate_captures(pos, moves);
+    }
+
+    score_moves(moves, scores, count, MOVE_NONE, ply);
+    Undo& undo = frame.undo;
+    int mover = pos.side;
+    int searched = 0;
+    for (int i = 0; i < count; i++) {
+        pick_move(moves, scores, count, i);
+        pos.do_move(moves[i], undo);
+        if (!in_check && pos.in_check(mover)) {
+            pos.undo_move(undo);
+            continue;
+        }
+        searched++;
+        int score = -qsearch(-beta, -alpha, ply + 1);
+        pos.undo_move(undo);
+
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) {
+                    STAT_ADD(c, beta_cutoffs, 1);
+                    if (searched == 1) {
+                        STAT_ADD(c, first_move_cutoffs, 1);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+int SearchWorker::search(int alpha, int beta, int depth, int ply) {
+    SearchCounters& c = counters();
+    SearchFrame& frame = stack[ply];
+    frame.pv_length = ply;
+
+    if (ply > 0 && engine.stop.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    // 残局库命中时直接返回精确值：距将杀的半步数换算成杀棋分
+    if (ply > 0 && popcount(pos.occupied()) <= tb_max_pieces()) {
+        int wdl, plies;
+        if (tb_probe_dtm(pos, wdl, plies)) {
+            return wdl == TB_DRAW_WDL ? 0 : wdl == TB_WIN ? SCORE_MATE - ply - plies : -SCORE_MATE + ply + plies;
+        }
+    }
+    bool in_check = pos.in_check(pos.side);
+    if (in_check) {
+        depth++; // 将军延伸
+    }
+    if (depth <= 0) {
+        return qsearch(alpha, beta, ply);
+    }
+
+    counter_add(c.nodes, 1);
+    STAT_MAX(c, seldepth, ply);
+    if (id == 0 && (c.nodes.load(std::memory_order_relaxed) & 1023) == 0) {
+        engine.check_limits();
+    }
+    if (ply >= MAX_PLY - 1) {
+        return evaluate_noisy();
+    }
+
+    bool pv_node = beta - alpha > 1;
+    if (ply > 0) {
+        // 将杀距离剪枝
+        if (alpha < -SCORE_MATE + ply) alpha = -SCORE_MATE + ply;
+        if (beta > SCORE_MATE - ply - 1) beta = SCORE_MATE - ply - 1;
+        if (alpha >= beta) return alpha;
+    }
+
+    TTEntry tte;
+    MoveCode tt_move = MOVE_NONE;
+    STAT_ADD(c, tt_probes, 1);
+    if (engine.tt.probe(pos.key, tte)) {
+        STAT_ADD(c, tt_hits, 1);
+        tt_move = tte.move;
+        int tt_score = score_from_tt(tte.score, ply);
+        if (!pv_node && ply > 0 && tte.depth >= depth) {
+            if (tte.bound == BOUND_EXACT
+                || (tte.bound == BOUND_LOWER && tt_score >= beta)
+                || (tte.bound == BOUND_UPPER && tt_score <= alpha)) {
+                return tt_score;
+            }
+        }
+    }
+
+    MoveCode* moves = frame.moves;
+    int* scores = frame.scores;
+    int count = in_check ? generate_evasions(pos, moves) : generate_pseudo_moves(pos, moves);
+    score_moves(moves, scores, count, tt_move, ply);
+
+    int original_alpha = alpha;
+    int best = -SCORE_INF;
+    MoveCode best_move = MOVE_NONE;
+    int legal = 0;
+    int mover = pos.side;
+    Undo& undo = frame.undo;
+
+    for (int i = 0; i < count; i++) {
+        pick_move(moves, scores, count, i);
+        MoveCode m = moves[i];
+        bool capture = pos.squares[move_to(m)] != EMPTY;
+        if (ply == 0 && is_excluded(m)) {
+            continue;
+        }
+
+        pos.do_move(m, undo);
+        // 子节点还会继续全宽搜索时才会探测置换表，提前预取它的桶
+        if (depth > 1) {
+            engine.tt.prefetch(pos.key);
+        }
+        if (!in_check && pos.in_check(mover)) {
+            pos.undo_move(undo);
+            continue;
+        }
+        legal++;
+
+        // PVS：第一步全窗口，其余先用零窗口试探
+        uint64_t nodes_before = c.nodes.load(std::memory_order_relaxed);
+        int score;
+        if (legal == 1) {
+            score = -search(-beta, -alpha, depth - 1, ply + 1);
+        } else {
+            score = -search(-alpha - 1, -alpha, depth - 1, ply + 1);
+            if (score > alpha && score < beta) {
+                score = -search(-beta, -alpha, depth - 1, ply + 1);
+            }
+        }
+        pos.undo_move(undo);
+
+        if (engine.stop.load(std::memory_order_relaxed) && (ply > 0 || legal > 1)) {
+            return best > -SCORE_INF ? best : 0;
+        }
+
+        uint64_t spent = c.nodes.load(std::memory_order_relaxed) - nodes_before;
+        if (ply == 0) {
+            root_total_nodes += spent;
+        }
+        if (score > best) {
+            best = score;
+            best_move = m;
+            if (ply == 0) {
+                root_best_nodes = spent;
+            }
+            if (score > alpha) {
+                alpha = score;
+                update_pv(ply, m);
+                if (alpha >= beta) {
+                    STAT_ADD(c, beta_cutoffs, 1);
+                    if (legal == 1) {
+                        STAT_ADD(c, first_move_cutoffs, 1);
+                    }
+                    if (!capture) {
+                        if (frame.killers[0] != m) {
+                            frame.killers[1] = frame.killers[0];
+                            frame.killers[0] = m;
+                        }
+                        // 越接近上限加得越少，历史分保持在 HISTORY_MAX 以内
+                        int& h = history[move_from(m)][move_to(m)];
+                        int bonus = depth * depth < HISTORY_MAX ? depth * depth : HISTORY_MAX;
+                        h += bonus - h * bonus / HISTORY_MAX;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    if (ply == 0 && excluded_count == 0) {
+        root_moves = legal;
+    }
+    if (legal == 0) {
+        return in_check ? -SCORE_MATE + ply : 0;
+    }
+
+    // 排除了部分根走法的结果不是根局面的真实值，不能写入置换表
+    if (ply > 0 || excluded_count == 0) {
+        int bound = best >= beta ? BOUND_LOWER : (best > original_alpha ? BOUND_EXACT : BOUND_UPPER);
+        engine.tt.store(pos.key, best_move, score_to_tt(best, ply), depth, bound);
+    }
+    return best;
+}
+
+SearchWorker::SearchWorker(Engine& engine, int id) : engine(engine), id(id) {
+    void* mem = NULL;
+    if (posix_memalign(&mem, 64, sizeof(SearchFrame) * (MAX_PLY + 1)) != 0) {
+        throw std::bad_alloc();
+    }
+    stack = (SearchFrame*)mem;
+    memset(stack, 0, sizeof(SearchFrame) * (MAX_PLY + 1));
+    clear_history();
+}
+
+SearchWorker::~SearchWorker() {
+    free(stack);
+}
+
+void SearchWorker::idle_loop(uint64_t seen) {
+    while (true) {
+        bool clear;
+        {
+            std::unique_lock<std::mutex> lock(engine.pool_mutex);
+            engine.pool_start.wait(lock, [this, seen]() { return engine.pool_quit || engine.search_id != seen; });
+            if (engine.pool_quit) {
+                return;
+            }
+            seen = engine.search_id;
+            clear = engine.pool_clear;
+        }
+        if (clear) {
+            engine.tt.clear_slice(id, engine.thread_count());
+            std::lock_guard<std::mutex> lock(engine.pool_mutex);
+            if (--engine.helpers_running == 0) {
+                engine.pool_done.notify_all();
+            }
+            continue;
+        }
+#ifdef CHESS_ALLOC_COUNT
+        uint64_t allocations_before = alloc_count();
+#endif
+        start(engine.root);
+        std::lock_guard<std::mutex> lock(engine.pool_mutex);
+#ifdef CHESS_ALLOC_COUNT
+        engine.stats.allocations += alloc_count() - allocations_before;
+#endif
+        if (--engine.helpers_running == 0) {
+            engine.pool_done.notify_all();
+        }
+    }
+}
+
+void SearchWorker::start(const Position& root) {
+    pos = root;
+    for (int ply = 0; ply <= MAX_PLY; ply++) {
+        stack[ply].killers[0] = stack[ply].killers[1] = MOVE_NONE;
+    }
+    // 上一次搜索的历史分减半后保留，新局面上旧的统计逐渐失效
+    for (int from = 0; from < 64; from++) {
+        for (int to = 0; to < 64; to++) {
+            history[from][to] /= 2;
+        }
+    }
+    memset(&result, 0, sizeof(result));
+    completed_depth = 0;
+    line_count = 0;
+    excluded_count = 0;
+
+    // 多主变例只由主线程计算，辅助线程照常搜索、通过置换表帮忙
+    int multipv = 1;
+    if (id == 0 && engine.limits.multipv > 1) {
+        multipv = std::min(std::min(engine.limits.multipv, MAX_MULTIPV), generate_legal_moves(pos, stack[0].moves));
+        multipv = std::max(multipv, 1);
+    }
+
+    int max_depth = engine.limits.depth > 0 ? engine.limits.depth : MAX_PLY - 1;
+    for (int depth = 1; depth <= max_depth; depth++) {
+        // 辅助线程错开深度，减少与主线程的重复搜索
+        if (id > 0 && depth > 1 && (depth + id) % 3 == 0) {
+            continue;
+        }
+        root_best_nodes = root_total_nodes = 0;
+
+        // 第 k 条主变例在排除前 k-1 条首步的根节点上搜索，各条线共享置换表
+        SearchResult found[MAX_MULTIPV];
+        int found_count = 0;
+        bool aborted = false;
+        excluded_count = 0;
+        for (int k = 0; k < multipv; k++) {
+            int score = search(-SCORE_INF, SCORE_INF, depth, 0);
+            if (engine.stop.load(std::memory_order_relaxed) && completed_depth > 0) {
+                aborted = true;
+                break;
+            }
+            SearchResult& line = found[found_count++];
+            line.depth = depth;
+            line.score = score;
+            line.pv_length = stack[0].pv_length;
+            memcpy(line.pv, stack[0].pv, sizeof(MoveCode) * stack[0].pv_length);
+            line.best_move = stack[0].pv_length > 0 ? stack[0].pv[0] : MOVE_NONE;
+            if (line.best_move == MOVE_NONE) {
+                break;
+            }
+            root_excluded[excluded_count++] = line.best_move;
+        }
+        excluded_count = 0;
+        if (aborted) {
+            break;
+        }
+
+        // 搜索不稳定时后面的线可能比前面分数高，按分数重新排序
+        for (int i = 1; i < found_count; i++) {
+            SearchResult line = found[i];
+            int j = i;
+            for (; j > 0 && found[j - 1].score < line.score; j--) {
+                found[j] = found[j - 1];
+            }
+            found[j] = line;
+        }
+        memcpy(lines, found, sizeof(SearchResult) * found_count);
+        line_count = found_count;
+
+        completed_depth = depth;
+        result = found[0];
+        int score = result.score;
+
+        if (id == 0) {
+            SearchStats& stats = engine.stats;
+            IterationStats& it = stats.iterations[stats.iteration_count++];
+            it.depth = depth;
+            it.score = score;
+            it.nodes = counters().nodes.load(std::memory_order_relaxed);
+            it.time_ms = engine.elapsed_ms();
+        }
+
+        // 找到将杀后不必继续加深
+        if (result.best_move == MOVE_NONE || (multipv == 1 && abs(score) >= SCORE_MATE_IN_MAX)) {
+            break;
+        }
+
+        // 时间管理只看主线程：只有一步可走时直接返回，否则由软上限决定是否继续加深
+        if (id == 0 && engine.time.enabled) {
+            double share = root_total_nodes ? (double)root_best_nodes / root_total_nodes : 0;
+            if (root_moves == 1
+                || engine.time.stop_after_iteration(engine.elapsed_ms(), depth, result.best_move, score, share)) {
+                break;
+            }
+        }
+    }
+}
+
+Engine::Engine() : search_id(0), helpers_running(0), pool_quit(false), pool_clear(false), counters(NULL), stop(false) {
+    memset(&limits, 0, sizeof(limits));
+    memset(&stats, 0, sizeof(stats));
+    set_threads(1);
+    set_hash(16);
+}
+
+Engine::~Engine() {
+    set_threads(0);
+}
+
+void Engine::set_threads(int count) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        pool_quit = true;
+    }
+    pool_start.notify_all();
+    for (size_t i = 0; i < helpers.size(); i++) {
+        helpers[i].join();
+    }
+    helpers.clear();
+    pool_quit = false;
+    for (size_t i = 0; i < workers.size(); i++) {
+        delete workers[i];
+    }
+    workers.clear();
+    if (counters) {
+        for (int i = 0; i < stats.threads; i++) {
+            counters[i].~SearchCounters();
+        }
+        free(counters);
+        counters = NULL;
+    }
+    stats.threads = count;
+    if (count <= 0) {
+        return;
+    }
+
+    void* mem = NULL;
+    if (posix_memalign(&mem, 64, sizeof(SearchCounters) * count) != 0) {
+        throw std::bad_alloc();
+    }
+    counters = (SearchCounters*)mem;
+    for (int i = 0; i < count; i++) {
+        new (&counters[i]) SearchCounters();
+        counters[i].reset();
+        workers.push_back(new SearchWorker(*this, i));
+    }
+    for (int i = 1; i < count; i++) {
+        helpers.push_back(std::thread(&SearchWorker::idle_loop, workers[i], search_id));
+    }
+}
+
+// 置换表由各搜索线程自己并行清零，先设置线程数再设置大小
+void Engine::set_hash(size_t mb) {
+    tt.resize(mb);
+    clear_hash();
+}
+
+void Engine::new_game() {
+    clear_hash();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i]->clear_history();
+    }
+}
+
+// 唤醒辅助线程各清一段，主线程清第 0 段。线程没有绑核，NUMA 机器上的页只是落在
+// 清零时各线程所在的节点，操作系统后来迁移线程时不会跟着移动
+void Engine::clear_hash() {
+    int count = thread_count();
+    if (count > 1) {
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            pool_clear = true;
+            helpers_running = count - 1;
+            search_id++;
+        }
+        pool_start.notify_all();
+    }
+    tt.clear_slice(0, count);
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    pool_done.wait(lock, [this]() { return helpers_running == 0; });
+    pool_clear = false;
+}
+
+double Engine::elapsed_ms() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// 只由主线程调用：至少完成一层搜索之后，才会因为时间或节点上限而停止
+void Engine::check_limits() {
+    if (workers[0]->completed_depth == 0) {
+        return;
+    }
+    if (time.enabled && elapsed_ms() >= time.hard_ms) {
+        stop.store(true, std::memory_order_relaxed);
+    }
+    if (limits.nodes > 0) {
+        uint64_t total = 0;
+        for (size_t i = 0; i < workers.size(); i++) {
+            total += counters[i].nodes.load(std::memory_order_relaxed);
+        }
+        if (total >= limits.nodes) {
+            stop.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+SearchResult Engine::search(const Position& pos, const SearchLimits& search_limits) {
+    limits = search_limits;
+    stop.store(false, std::memory_order_relaxed);
+    start_time = std::chrono::steady_clock::now();
+    time.start(limits);
+    tt.new_search();
+    int thread_count = (int)workers.size();
+    for (int i = 0; i < thread_count; i++) {
+        counters[i].reset();
+    }
+    stats.iteration_count = 0;
+    stats.allocations = 0;
+
+#ifdef CHESS_ALLOC_COUNT
+    uint64_t allocations_before = alloc_count();
+#endif
+    if (thread_count > 1) {
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            root = pos;
+            helpers_running = thread_count - 1;
+            search_id++;
+        }
+        pool_start.notify_all();
+    }
+    workers[0]->start(pos);
+    stop.store(true, std::memory_order_relaxed);
+    {
+        std::unique_lock<std::mutex> lock(pool_mutex);
+        pool_done.wait(lock, [this]() { return helpers_running == 0; });
+    }
+#ifdef CHESS_ALLOC_COUNT
+    stats.allocations += alloc_count() - allocations_before;
+#endif
+
+    aggregate_counters(counters, thread_count, stats);
+    stats.time_ms = elapsed_ms();
+    stats.depth = workers[0]->result.depth;
+    stats.nps = stats.time_ms > 0 ? (uint64_t)(stats.nodes * 1000.0 / stats.time_ms) : 0;
+    return workers[0]->result;
+}
+
+int Engine::analyze(const Position& pos, const SearchLimits& search_limits, int count, SearchResult* lines) {
+    SearchLimits analysis_limits = search_limits;
+    analysis_limits.multipv = count;
+    search(pos, analysis_limits);
+    SearchWorker* main = workers[0];
+    int n = std::min(count, main->line_count);
+    for (int i = 0; i < n; i++) {
+        lines[i] = main->lines[i];
+    }
+    return n;
+}
@@ -0,0 +1,90 @@
+#include "search_stats.h"
+#include <cstring>
+
+void SearchCounters::reset() {
+    nodes.store(0, std::memory_order_relaxed);
+#if SEARCH_STATS_ENABLED
+    qnodes.store(0, std::memory_order_relaxed);
+    tt_probes.store(0, std::memory_order_relaxed);
+    tt_hits.store(0, std::memory_order_relaxed);
+    beta_cutoffs.store(0, std::memory_order_relaxed);
+    first_move_cutoffs.store(0, std::memory_order_relaxed);
+    seldepth.store(0, std::memory_order_relaxed);
+#endif
+}
+
+void aggregate_counters(const SearchCounters* counters, int count, SearchStats& stats) {
+    stats.threads = count;
+    stats.nodes = 0;
+    stats.qnodes = stats.tt_probes = stats.tt_hits = 0;
+    stats.beta_cutoffs = stats.first_move_cutoffs = 0;
+    stats.seldepth = 0;
+    for (int i = 0; i < count; i++) {
+        stats.nodes += counters[i].nodes.load(std::memory_order_relaxed);
+#if SEARCH_STATS_ENABLED
+        stats.qnodes += counters[i].qnodes.load(std::memory_order_relaxed);
+        stats.tt_probes += counters[i].tt_probes.load(std::memory_order_relaxed);
+        stats.tt_hits += counters[i].tt_hits.load(std::memory_order_relaxed);
+        stats.beta_cutoffs += counters[i].beta_cutoffs.load(std::memory_order_relaxed);
+        stats.first_move_cutoffs += counters[i].first_move_cutoffs.load(std::memory_order_relaxed);
+        int sd = counters[i].seldepth.load(std::memory_order_relaxed);
+        if (sd > stats.seldepth) stats.seldepth = sd;
+#endif
+    }
+}
+
+static double ratio(uint64_t part, uint64_t total) {
+    return total ? (double)part / total : 0.0;
+}
+
+bool write_stats_json(const SearchStats& s, FILE* out) {
+    fprintf(out, "{\"threads\":%d,\"depth\":%d,\"seldepth\":%d,\"nodes\":%llu,\"qnodes\":%llu,"
+                 "\"tt_probes\":%llu,\"tt_hits\":%llu,\"tt_hit_rate\":%.4f,"
+                 "\"beta_cutoffs\":%llu,\"first_move_cutoffs\":%llu,\"first_move_cutoff_rate\":%.4f,"
+                 "\"time_ms\":%.3f,\"nps\":%llu,\"iterations\":[",
+            s.threads, s.depth, s.seldepth, (unsigned long long)s.nodes, (unsigned long long)s.qnodes,
+            (unsigned long long)s.tt_probes, (unsigned long long)s.tt_hits, ratio(s.tt_hits, s.tt_probes),
+            (unsigned long long)s.beta_cutoffs, (unsigned long long)s.first_move_cutoffs,
+            ratio(s.first_move_cutoffs, s.beta_cutoffs), s.time_ms, (unsigned long long)s.nps);
+    for (int i = 0; i < s.iteration_count; i++) {
+        fprintf(out, "%s{\"depth\":%d,\"score\":%d,\"nodes\":%llu,\"time_ms\":%.3f}", i ? "," : "",
+                s.iterations[i].depth, s.iterations[i].score,
+                (unsigned long long)s.iterations[i].nodes, s.iterations[i].time_ms);
+    }
+    return fprintf(out, "]}\n") > 0;
+}
+
+bool write_stats_prometheus(const SearchStats& s, FILE* out) {
+    fprintf(out, "# TYPE chess_search_nodes counter\nchess_search_nodes %llu\n", (unsigned long long)s.nodes);
+    fprintf(out, "# TYPE chess_search_qnodes counter\nchess_search_qnodes %llu\n", (unsigned long long)s.qnodes);
+    fprintf(out, "# TYPE chess_search_tt_probes counter\nchess_search_tt_probes %llu\n", (unsigned long long)s.tt_probes);
+    fprintf(out, "# TYPE chess_search_tt_hits counter\nchess_search_tt_hits %llu\n", (unsigned long long)s.tt_hits);
+    fprintf(out, "# TYPE chess_search_beta_cutoffs counter\nchess_search_beta_cutoffs %llu\n", (unsigned long long)s.beta_cutoffs);
+    fprintf(out, "# TYPE chess_search_first_move_cutoffs counter\nchess_search_first_move_cutoffs %llu\n",
+            (unsigned long long)s.first_move_cutoffs);
+    fprintf(out, "# TYPE chess_search_depth gauge\nchess_search_depth %d\n", s.depth);
+    fprintf(out, "# TYPE chess_search_seldepth gauge\nchess_search_seldepth %d\n", s.seldepth);
+    fprintf(out, "# TYPE chess_search_threads gauge\nchess_search_threads %d\n", s.threads);
+    fprintf(out, "# TYPE chess_search_time_ms gauge\nchess_search_time_ms %.3f\n", s.time_ms);
+    fprintf(out, "# TYPE chess_search_nps gauge\nchess_search_nps %llu\n", (unsigned long long)s.nps);
+    fprintf(out, "# TYPE chess_search_iteration_time_ms gauge\n");
+    for (int i = 0; i < s.iteration_count; i++) {
+        fprintf(out, "chess_search_iteration_time_ms{depth=\"%d\"} %.3f\n", s.iterations[i].depth, s.iterations[i].time_ms);
+    }
+    return !ferror(out);
+}
+
+bool dump_stats(const SearchStats& stats, const char* path, bool prometheus) {
+#if SEARCH_STATS_ENABLED
+    // Prometheus 文本每次覆盖写入，JSON 每步追加一行
+    FILE* out = fopen(path, prometheus ? "w" : "a");
+    if (!out) {
+        return false;
+    }
+    bool ok = prometheus ? write_stats_prometheus(stats, out) : write_stats_json(stats, out);
+    return fclose(out) == 0 && ok;
+#else
+    (void)stats; (void)path; (void)prometheus;
+    return false;
+#endif
+}
@@ -0,0 +1,878 @@
+#include "server.h"
+#include "search.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#define MAX_EVENTS 256
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1"
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int) {
+    stop_requested = 1;
+}
+
+// ---- 会话池：启动时一次分配好，开局和结束只在空闲链表上取放 ----
+
+typedef struct {
+    Position pos;
+    uint16_t generation;    // 每次分配加一，旧会话号随之失效
+    int ply;
+    bool active;
+    bool busy;              // 正在为它搜索，搜索结束前不接受走子
+    uint64_t owner;         // 创建它的连接序号，连接断开时会话随之关闭
+    bool orphaned;          // 连接已断开但搜索未完成，搜索结束后关闭
+} Session;
+
+class SessionPool {
+public:
+    explicit SessionPool(int capacity) : sessions(capacity), active_count(0) {
+        for (int i = capacity - 1; i >= 0; i--) {
+            sessions[i].generation = 0;
+            sessions[i].active = false;
+            free_list.push_back(i);
+        }
+    }
+
+    // 返回会话号，池满时返回 0（有效会话号的代数至少为 1）
+    uint32_t open(const Position& start) {
+        if (free_list.empty()) {
+            return 0;
+        }
+        int index = free_list.back();
+        free_list.pop_back();
+        Session& s = sessions[index];
+        if (++s.generation == 0) {
+            s.generation = 1;
+        }
+        s.pos = start;
+        s.ply = 0;
+        s.active = true;
+        s.busy = false;
+        s.owner = 0;
+        s.orphaned = false;
+        active_count++;
+        return ((uint32_t)s.generation << 16) | (uint32_t)index;
+    }
+
+    Session* get(uint32_t id) {
+        uint32_t index = id & 0xFFFF;
+        if (index >= sessions.size()) {
+            return NULL;
+        }
+        Session& s = sessions[index];
+        return s.active && s.generation == (id >> 16) ? &s : NULL;
+    }
+
+    void close(uint32_t id) {
+        Session* s = get(id);
+        if (s) {
+            s->active = false;
+            free_list.push_back((int)(id & 0xFFFF));
+            active_count--;
+        }
+    }
+
+    int active() const { return active_count; }
+
+private:
+    std::vector<Session> sessions;
+    std::vector<int> free_list;
+    int active_count;
+};
+
+// ---- 请求解析 ----
+
+typedef struct {
+    int op;
+    bool binary;
+    long long id;           // JSON 的 id 原样返回，二进制为 -1
+    bool has_session;
+    uint32_t session;
+    char move[8];
+    uint16_t move_code;
+    char fen[128];
+    uint64_t nodes;
+    int depth;
+    int deadline_ms;
+} Request;
+
+static const char* const op_names[] = {"", "new", "move", "ai", "status", "close"};
+
+static const char* skip_space(const char* p) {
+    while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+    return p;
+}
+
+// 读取一个 JSON 字符串，只处理 \" 和 \\ 转义；返回结束引号之后的位置，出错返回 NULL
+static const char* parse_string(const char* p, char* out, size_t size) {
+    if (*p++ != '"') {
+        return NULL;
+    }
+    size_t n = 0;
+    while (*p && *p != '"') {
+        if (*p == '\\' && p[1]) {
+            p++;
+        }
+        if (n + 1 < size) {
+            out[n++] = *p;
+        }
+        p++;
+    }
+    out[n] = '\0';
+    return *p == '"' ? p + 1 : NULL;
+}
+
+// 只支持一层对象，值为字符串、整数或 true / false / null；不认识的键忽略
+static bool parse_json(const char* line, Request& req) {
+    memset(&req, 0, sizeof(req));
+    req.id = -1;
+    const char* p = skip_space(line);
+    if (*p++ != '{') {
+        return false;
+    }
+    p = skip_space(p);
+    if (*p == '}') {
+        return false;
+    }
+    while (true) {
+        char key[32], text[128];
+        p = parse_string(skip_space(p), key, sizeof(key));
+        if (!p) return false;
+        p = skip_space(p);
+        if (*p++ != ':') return false;
+        p = skip_space(p);
+        long long number = 0;
+        text[0] = '\0';
+        if (*p == '"') {
+            p = parse_string(p, text, sizeof(text));
+            if (!p) return false;
+        } else if (*p == '-' || (*p >= '0' && *p <= '9')) {
+            char* end;
+            number = strtoll(p, &end, 10);
+            p = end;
+        } else if (strncmp(p, "true", 4) == 0 || strncmp(p, "null", 4) == 0) {
+            p += 4;
+        } else if (strncmp(p, "false", 5) == 0) {
+            p += 5;
+        } else {
+            return false;
+        }
+
+        if (strcmp(key, "op") == 0) {
+            for (int op = OP_NEW; op <= OP_CLOSE; op++) {
+                if (strcmp(text, op_names[op]) == 0) req.op = op;
+            }
+        } else if (strcmp(key, "id") == 0) {
+            req.id = number;
+        } else if (strcmp(key, "session") == 0) {
+            req.has_session = true;
+            req.session = (uint32_t)number;
+        } else if (strcmp(key, "move") == 0) {
+            // 过长的着法不截断，直接按错误请求处理
+            if (strlen(text) >= sizeof(req.move)) {
+                return false;
+            }
+            memcpy(req.move, text, strlen(text) + 1);
+        } else if (strcmp(key, "fen") == 0) {
+            snprintf(req.fen, sizeof(req.fen), "%s", text);
+        } else if (strcmp(key, "nodes") == 0) {
+            req.nodes = number > 0 ? (uint64_t)number : 0;
+        } else if (strcmp(key, "depth") == 0) {
+            req.depth = (int)number;
+        } else if (strcmp(key, "deadline_ms") == 0) {
+            req.deadline_ms = (int)number;
+        }
+
+        p = skip_space(p);
+        if (*p == '}') break;
+        if (*p++ != ',') return false;
+    }
+    return req.op != 0;
+}
+
+static void parse_binary(const BinaryRequest& b, Request& req) {
+    memset(&req, 0, sizeof(req));
+    req.binary = true;
+    req.id = -1;
+    req.op = b.op;
+    req.has_session = true;
+    req.session = b.session;
+    req.move_code = b.move;
+    req.nodes = b.nodes;
+    req.deadline_ms = (int)b.deadline_ms;
+}
+
+// "e2e4" 形式的走法，在合法走法中查找；找不到时返回 MOVE_NONE
+static MoveCode find_move(Position& pos, const char* text, uint16_t code) {
+    MoveCode moves[MAX_MOVES];
+    int count = generate_legal_moves(pos, moves);
+    for (int i = 0; i < count; i++) {
+        char buf[8];
+        move_to_string(moves[i], buf);
+        if ((text[0] && strcmp(buf, text) == 0) || (!text[0] && moves[i] == code)) {
+            return moves[i];
+        }
+    }
+    return MOVE_NONE;
+}
+
+static const char* status_name(int status) {
+    switch (status) {
+        case STATUS_CHECK:     return "check";
+        case STATUS_CHECKMATE: return "checkmate";
+        case STATUS_STALEMATE: return "stalemate";
+        default:               return "normal";
+    }
+}
+
+// ---- AI 任务：主线程放入有界队列，工作线程取出搜索，结果放回完成队列并通过 eventfd 唤醒主线程 ----
+
+typedef struct {
+    int fd;
+    uint64_t connection;    // 连接序号，连接关闭后完成的任务直接丢弃
+    uint64_t slot;          // 应答在连接上的顺序号
+    Request req;
+    Position pos;
+    Clock::time_point deadline;
+    bool has_deadline;
+    // 结果
+    int error;
+    SearchResult result;
+    uint64_t nodes;
+} Job;
+
+class WorkerPool {
+public:
+    WorkerPool(int workers, int capacity, int hash_mb, int wake_fd)
+        : capacity(capacity), wake_fd(wake_fd), stopping(false) {
+        for (int i = 0; i < workers; i++) {
+            threads.push_back(std::thread(&WorkerPool::worker_main, this, hash_mb));
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    }
+
+    // 队列已满时返回 false
+    bool submit(const Job& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if ((int)pending.size() >= capacity) {
+                return false;
+            }
+            pending.push_back(job);
+        }
+        ready.notify_one();
+        return true;
+    }
+
+    void take_completed(std::vector<Job>& out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        out.assign(completed.begin(), completed.end());
+        completed.clear();
+    }
+
+    int queued() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return (int)pending.size();
+    }
+
+private:
+    void worker_main(int hash_mb) {
+        Engine engine;
+        engine.set_hash(hash_mb);
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this]() { return stopping || !pending.empty(); });
+                if (stopping) {
+                    return;
+                }
+                job = pending.front();
+                pending.pop_front();
+            }
+            run(engine, job);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                completed.push_back(job);
+            }
+            uint64_t one = 1;
+            ssize_t written = write(wake_fd, &one, sizeof(one));
+            (void)written;
+        }
+    }
+
+    // 在队列里等过了期限就不再搜索；否则剩余时间作为这一步的用时上限
+    static void run(Engine& engine, Job& job) {
+        SearchLimits limits;
+        memset(&limits, 0, sizeof(limits));
+        limits.nodes = job.req.nodes;
+        limits.depth = job.req.depth;
+        if (job.has_deadline) {
+            long long left = std::chrono::duration_cast<std::chrono::milliseconds>(job.deadline - Clock::now()).count();
+            if (left <= 0) {
+                job.error = SERVER_ERROR_DEADLINE;
+                return;
+            }
+            limits.time_ms = (int)left;
+        }
+        job.result = engine.search(job.pos, limits);
+        job.nodes = engine.last_stats().nodes;
+        job.error = job.result.best_move == MOVE_NONE ? SERVER_ERROR_ILLEGAL : 0;
+    }
+
+    int capacity;
+    int wake_fd;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Job> pending;
+    std::vector<Job> completed;
+    std::vector<std::thread> threads;
+};
+
+// ---- 连接与主循环 ----
+
+#define MODE_UNKNOWN 0
+#define MODE_JSON    1
+#define MODE_BINARY  2
+
+typedef struct {
+    std::string data;
+    bool ready;
+} HeldReply;
+
+// 应答按请求顺序发出：AI 请求在搜索结束前占住自己的位置，其后的应答先留在 held 里
+typedef struct {
+    int fd;
+    uint64_t serial;
+    int mode;
+    bool writing;           // 已注册 EPOLLOUT
+    std::string in;
+    std::string out;
+    std::deque<HeldReply> held;
+    uint64_t held_base;     // held.front() 的顺序号
+    size_t held_bytes;
+    std::vector<uint32_t> owned;    // 本连接创建的会话
+} Connection;
+
+class Server {
+public:
+    Server(const ServerOptions& options, int epoll_fd, int wake_fd)
+        : options(options), epoll_fd(epoll_fd), wake_fd(wake_fd), next_serial(1),
+          sessions(options.max_sessions),
+          workers(options.workers, options.queue_size, options.hash_mb, wake_fd) {
+        start.set_fen(START_FEN);
+    }
+
+    ~Server() {
+        for (auto& it : connections) {
+            close(it.first);
+            delete it.second;
+        }
+    }
+
+    void accept_all(int listen_fd) {
+        while (true) {
+            int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            Connection* c = new Connection();
+            c->fd = fd;
+            c->serial = next_serial++;
+            c->mode = MODE_UNKNOWN;
+            c->writing = false;
+            c->held_base = 0;
+            c->held_bytes = 0;
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+            connections[fd] = c;
+        }
+    }
+
+    void on_readable(int fd) {
+        Connection* c = find(fd);
+        if (!c) return;
+        char buf[16384];
+        while (true) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n > 0) {
+                // 每读一块就处理掉完整的请求，输入缓冲区最多留下一行未完成的请求
+                c->in.append(buf, n);
+                if (c->mode == MODE_UNKNOWN) {
+                    c->mode = (uint8_t)c->in[0] == SERVER_BINARY_MAGIC ? MODE_BINARY : MODE_JSON;
+                }
+                if (!process_input(c)) {
+                    drop(c);
+                    return;
+                }
+                if (c->out.size() + c->held_bytes > SERVER_MAX_OUTPUT && !flush(c)) {
+                    return;
+                }
+                continue;
+            }
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                drop(c);
+                return;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+        }
+        flush(c);
+    }
+
+    void on_writable(int fd) {
+        Connection* c = find(fd);
+        if (c) flush(c);
+    }
+
+    // 工作线程完成的搜索：会话还在就把着法走上去，再回复请求方
+    void on_completed() {
+        uint64_t count;
+        ssize_t n = read(wake_fd, &count, sizeof(count));
+        (void)n;
+        std::vector<Job> done;
+        workers.take_completed(done);
+        for (size_t i = 0; i < done.size(); i++) {
+            Job& job = done[i];
+            Session* s = sessions.get(job.req.session);
+            if (s) {
+                s->busy = false;
+            }
+            if (s && s->orphaned) {
+                sessions.close(job.req.session);
+                s = NULL;
+            }
+            if (!job.error && !s) {
+                job.error = SERVER_ERROR_NO_SESSION;
+            }
+            if (!job.error) {
+                Undo undo;
+                s->pos.do_move(job.result.best_move, undo);
+                s->ply++;
+            }
+            auto it = connections.find(job.fd);
+            if (it == connections.end() || it->second->serial != job.connection) {
+                continue;
+            }
+            Connection* c = it->second;
+            HeldReply& held = c->held[job.slot - c->held_base];
+            if (job.error) {
+                reply_error(held.data, job.req, job.error);
+            } else {
+                reply(held.data, job.req, s, job.result.best_move, job.result.score, job.nodes);
+            }
+            held.ready = true;
+            c->held_bytes += held.data.size();
+            while (!c->held.empty() && c->held.front().ready) {
+                c->out += c->held.front().data;
+                c->held_bytes -= c->held.front().data.size();
+                c->held.pop_front();
+                c->held_base++;
+            }
+            flush(c);
+        }
+    }
+
+private:
+    Connection* find(int fd) {
+        auto it = connections.find(fd);
+        return it == connections.end() ? NULL : it->second;
+    }
+
+    // 连接创建的会话随连接关闭；正在搜索的会话等搜索结束后在 on_completed 里关闭
+    void drop(Connection* c) {
+        for (size_t i = 0; i < c->owned.size(); i++) {
+            Session* s = sessions.get(c->owned[i]);
+            if (!s || s->owner != c->serial) {
+                continue;
+            }
+            if (s->busy) {
+                s->orphaned = true;
+            } else {
+                sessions.close(c->owned[i]);
+            }
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        connections.erase(c->fd);
+        delete c;
+    }
+
+    // 处理缓冲区中完整的请求；返回 false 表示协议错误，需要断开
+    bool process_input(Connection* c) {
+        size_t used = 0;
+        if (c->mode == MODE_BINARY) {
+            while (c->in.size() - used >= sizeof(BinaryRequest)) {
+                BinaryRequest b;
+                memcpy(&b, c->in.data() + used, sizeof(b));
+                used += sizeof(b);
+                if (b.magic != SERVER_BINARY_MAGIC) {
+                    return false;
+                }
+                Request req;
+                parse_binary(b, req);
+                handle(c, req);
+            }
+        } else {
+            size_t end;
+            while ((end = c->in.find('\n', used)) != std::string::npos) {
+                std::string line = c->in.substr(used, end - used);
+                used = end + 1;
+                if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                    continue;
+                }
+                Request req;
+                if (!parse_json(line.c_str(), req)) {
+                    req.binary = false;
+                    std::string text;
+                    reply_error(text, req, SERVER_ERROR_BAD_REQUEST);
+                    emit(c, text);
+                    continue;
+                }
+                handle(c, req);
+            }
+            if (c->in.size() - used > SERVER_MAX_LINE) {
+                return false;
+            }
+        }
+        c->in.erase(0, used);
+        return true;
+    }
+
+    void handle(Connection* c, const Request& req) {
+        std::string text;
+        if (respond(c, req, text)) {
+            emit(c, text);
+        }
+    }
+
+    // 有应答排在未完成的 AI 请求之后时先留着，否则直接进入输出缓冲区
+    void emit(Connection* c, const std::string& text) {
+        if (c->held.empty()) {
+            c->out += text;
+            return;
+        }
+        HeldReply held;
+        held.data = text;
+        held.ready = true;
+        c->held.push_back(held);
+        c->held_bytes += text.size();
+    }
+
+    // 把应答写进 text；AI 请求交给工作线程时返回 false，应答在 on_completed 里补上
+    bool respond(Connection* c, const Request& req, std::string& text) {
+        if (req.op == OP_NEW) {
+            Position pos = start;
+            if (req.fen[0] && !pos.set_fen_strict(req.fen)) {
+                reply_error(text, req, SERVER_ERROR_BAD_REQUEST);
+                return true;
+            }
+            uint32_t id = sessions.open(pos);
+            if (!id) {
+                reply_error(text, req, SERVER_ERROR_FULL);
+                return true;
+            }
+            Session* s = sessions.get(id);
+            s->owner = c->serial;
+            c->owned.push_back(id);
+            Request r = req;
+            r.session = id;
+            reply(text, r, s, MOVE_NONE, 0, 0);
+            return true;
+        }
+        if (req.op == OP_STATUS && !req.has_session) {
+            reply_info(text, req);
+            return true;
+        }
+
+        Session* s = sessions.get(req.session);
+        if (!s) {
+            reply_error(text, req, SERVER_ERROR_NO_SESSION);
+            return true;
+        }
+        switch (req.op) {
+            case OP_STATUS:
+                reply(text, req, s, MOVE_NONE, 0, 0);
+                break;
+            case OP_CLOSE:
+                if (s->busy) {
+                    reply_error(text, req, SERVER_ERROR_BUSY);
+                    break;
+                }
+                reply(text, req, s, MOVE_NONE, 0, 0);
+                if (s->owner == c->serial) {
+                    c->owned.erase(std::find(c->owned.begin(), c->owned.end(), req.session));
+                }
+                sessions.close(req.session);
+                break;
+            case OP_MOVE: {
+                if (s->busy) {
+                    reply_error(text, req, SERVER_ERROR_BUSY);
+                    break;
+                }
+                MoveCode m = find_move(s->pos, req.move, req.move_code);
+                if (m == MOVE_NONE) {
+                    reply_error(text, req, SERVER_ERROR_ILLEGAL);
+                    break;
+                }
+                Undo undo;
+                s->pos.do_move(m, undo);
+                s->ply++;
+                reply(text, req, s, MOVE_NONE, 0, 0);
+                break;
+            }
+            case OP_AI: {
+                if (s->busy) {
+                    reply_error(text, req, SERVER_ERROR_BUSY);
+                    break;
+                }
+                Job job;
+                memset(&job.result, 0, sizeof(job.result));
+                job.fd = c->fd;
+                job.connection = c->serial;
+                job.slot = c->held_base + c->held.size();
+                job.req = req;
+                if (!job.req.nodes && !job.req.depth && !job.req.deadline_ms) {
+                    job.req.nodes = options.default_nodes;
+                }
+                job.pos = s->pos;
+                job.has_deadline = req.deadline_ms > 0;
+                job.deadline = Clock::now() + std::chrono::milliseconds(req.deadline_ms);
+                job.error = 0;
+                job.nodes = 0;
+                if (!workers.submit(job)) {
+                    reply_error(text, req, SERVER_ERROR_BUSY);
+                    break;
+                }
+                s->busy = true;
+                HeldReply held;
+                held.ready = false;
+                c->held.push_back(held);
+                return false;
+            }
+            default:
+                reply_error(text, req, SERVER_ERROR_BAD_REQUEST);
+        }
+        return true;
+    }
+
+    void reply(std::string& out, const Request& req, Session* s, MoveCode move, int score, uint64_t nodes) {
+        Position pos = s->pos;
+        int status = position_status(pos);
+        if (req.binary) {
+            BinaryResponse b;
+            memset(&b, 0, sizeof(b));
+            b.magic = SERVER_BINARY_MAGIC;
+            b.move = move;
+            b.session = req.session;
+            b.score = (int16_t)score;
+            b.status = (uint8_t)status;
+            b.side = (int8_t)pos.side;
+            b.nodes = (uint32_t)nodes;
+            out.append((const char*)&b, sizeof(b));
+            return;
+        }
+        char fen[128], line[512];
+        pos.to_fen(fen);
+        int n = snprintf(line, sizeof(line), "{\"id\":%lld,\"ok\":true,\"session\":%u,\"fen\":\"%s\",\"status\":\"%s\",\"ply\":%d",
+                         req.id, req.session, fen, status_name(status), s->ply);
+        if (req.op == OP_AI) {
+            char buf[8];
+            move_to_string(move, buf);
+            n += snprintf(line + n, sizeof(line) - n, ",\"move\":\"%s\",\"score\":%d,\"nodes\":%llu",
+                          buf, score, (unsigned long long)nodes);
+        }
+        snprintf(line + n, sizeof(line) - n, "}\n");
+        out += line;
+    }
+
+    void reply_error(std::string& out, const Request& req, int error) {
+        static const char* const messages[] = {
+            "", "bad request", "no such session", "illegal move", "busy", "deadline exceeded", "too many sessions"
+        };
+        if (req.binary) {
+            BinaryResponse b;
+            memset(&b, 0, sizeof(b));
+            b.magic = SERVER_BINARY_MAGIC;
+            b.error = (uint8_t)error;
+            b.session = req.session;
+            out.append((const char*)&b, sizeof(b));
+            return;
+        }
+        char line[160];
+        snprintf(line, sizeof(line), "{\"id\":%lld,\"ok\":false,\"error\":\"%s\"}\n", req.id, messages[error]);
+        out += line;
+    }
+
+    void reply_info(std::string& out, const Request& req) {
+        char line[200];
+        snprintf(line, sizeof(line),
+                 "{\"id\":%lld,\"ok\":true,\"sessions\":%d,\"connections\":%zu,\"queued\":%d,\"workers\":%d}\n",
+                 req.id, sessions.active(), connections.size(), workers.queued(), options.workers);
+        if (req.binary) {
+            reply_error(out, req, SERVER_ERROR_BAD_REQUEST);
+            return;
+        }
+        out += line;
+    }
+
+    // 尽量写出；写不完时注册 EPOLLOUT，写完后取消。
+    // 积压的应答（含排队等候的）超过 SERVER_MAX_OUTPUT 说明对方不读，断开连接；连接被断开时返回 false
+    bool flush(Connection* c) {
+        while (!c->out.empty()) {
+            ssize_t n = write(c->fd, c->out.data(), c->out.size());
+            if (n > 0) {
+                c->out.erase(0, n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                drop(c);
+                return false;
+            }
+            break;
+        }
+        if (c->out.size() + c->held_bytes > SERVER_MAX_OUTPUT) {
+            drop(c);
+            return false;
+        }
+        bool want = !c->out.empty();
+        if (want != c->writing) {
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            if (want) {
+                ev.events |= EPOLLOUT;
+            }
+            ev.data.fd = c->fd;
+            epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+            c->writing = want;
+        }
+        return true;
+    }
+
+    const ServerOptions& options;
+    int epoll_fd;
+    int wake_fd;
+    uint64_t next_serial;
+    Position start;
+    SessionPool sessions;
+    WorkerPool workers;
+    std::unordered_map<int, Connection*> connections;
+};
+
+static int listen_unix(const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "chess_server: socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int run_server(const ServerOptions& options) {
+    if (options.max_sessions <= 0 || options.max_sessions > SERVER_MAX_SESSIONS) {
+        fprintf(stderr, "chess_server: max sessions must be between 1 and %d\n", SERVER_MAX_SESSIONS);
+        return 1;
+    }
+    int listen_fd = listen_unix(options.socket_path);
+    if (listen_fd < 0) {
+        return 1;
+    }
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    int wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    ev.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+
+    fprintf(stderr, "chess_server: listening on %s, %d workers, %d sessions\n",
+            options.socket_path, options.workers, options.max_sessions);
+    {
+        Server server(options, epoll_fd, wake_fd);
+        struct epoll_event events[MAX_EVENTS];
+        while (!stop_requested) {
+            int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+            for (int i = 0; i < n; i++) {
+                int fd = events[i].data.fd;
+                if (fd == listen_fd) {
+                    server.accept_all(listen_fd);
+                } else if (fd == wake_fd) {
+                    server.on_completed();
+                } else {
+                    if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                        server.on_readable(fd);
+                    }
+                    if (events[i].events & EPOLLOUT) {
+                        server.on_writable(fd);
+                    }
+                }
+            }
+        }
+    }
+    close(wake_fd);
+    close(epoll_fd);
+    close(listen_fd);
+    unlink(options.socket_path);
+    return 0;
+}
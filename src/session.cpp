@@ -0,0 +1,179 @@
+#include "session.h"
+#include "latency.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#define SESSION_NONE   0
+#define SESSION_RECORD 1
+#define SESSION_REPLAY 2
+
+static int mode = SESSION_NONE;
+static FILE* file = NULL;
+static bool realtime_replay = false;
+static bool finished = false;
+static uint64_t events = 0;
+static uint64_t last_us = 0;
+static MEVENT last_mouse;
+static int last_mouse_status = ERR;
+
+static void write_varint(uint64_t v) {
+    while (v >= 0x80) {
+        fputc((int)(v & 0x7F) | 0x80, file);
+        v >>= 7;
+    }
+    fputc((int)v, file);
+}
+
+static bool read_varint(uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(file);
+        if (c == EOF) {
+            return false;
+        }
+        v |= (uint64_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+bool session_record(const char* path, const SessionHeader& header) {
+    session_close();
+    file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    SessionHeader h = header;
+    h.magic = SESSION_MAGIC;
+    h.version = SESSION_VERSION;
+    if (fwrite(&h, sizeof(h), 1, file) != 1) {
+        fclose(file);
+        file = NULL;
+        return false;
+    }
+    mode = SESSION_RECORD;
+    events = 0;
+    last_us = latency_now_us();
+    return true;
+}
+
+bool session_replay(const char* path, SessionHeader& header, bool realtime) {
+    session_close();
+    file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != SESSION_MAGIC
+        || header.version != SESSION_VERSION) {
+        fclose(file);
+        file = NULL;
+        return false;
+    }
+    mode = SESSION_REPLAY;
+    realtime_replay = realtime;
+    finished = false;
+    events = 0;
+    last_us = latency_now_us();
+    return true;
+}
+
+void session_close() {
+    if (file) {
+        fclose(file);
+        file = NULL;
+    }
+    mode = SESSION_NONE;
+}
+
+// 回放：读下一个事件，按需要等到录制时的间隔
+static int replay_next() {
+    uint64_t delta, key;
+    if (finished || !read_varint(delta) || !read_varint(key)) {
+        finished = true;
+        return 'q';
+    }
+    int ch = (int)unzigzag(key);
+    if (ch == KEY_MOUSE) {
+        uint64_t x, y, state;
+        if (!read_varint(x) || !read_varint(y) || !read_varint(state)) {
+            finished = true;
+            return 'q';
+        }
+        memset(&last_mouse, 0, sizeof(last_mouse));
+        last_mouse.x = (int)x;
+        last_mouse.y = (int)y;
+        last_mouse.bstate = (mmask_t)state;
+        last_mouse_status = OK;
+    }
+    if (realtime_replay) {
+        uint64_t due = last_us + delta;
+        uint64_t now = latency_now_us();
+        if (due > now) {
+            std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+        }
+        last_us = due;
+    }
+    events++;
+    return ch;
+}
+
+int session_getch() {
+    if (mode == SESSION_REPLAY) {
+        return replay_next();
+    }
+    int ch = getch();
+    if (mode != SESSION_RECORD) {
+        if (ch == KEY_MOUSE) {
+            last_mouse_status = getmouse(&last_mouse);
+        }
+        return ch;
+    }
+    // 计时对局里 getch 定时返回 ERR 刷新棋钟，这些空转也记下，回放时帧数和按键顺序都一致
+    uint64_t now = latency_now_us();
+    write_varint(now - last_us);
+    write_varint(zigzag(ch));
+    last_us = now;
+    if (ch == KEY_MOUSE) {
+        // 立即取出鼠标事件一起记录，之后的 session_getmouse 直接返回它
+        last_mouse_status = getmouse(&last_mouse);
+        if (last_mouse_status != OK) {
+            memset(&last_mouse, 0, sizeof(last_mouse));
+        }
+        write_varint((uint64_t)(last_mouse.x < 0 ? 0 : last_mouse.x));
+        write_varint((uint64_t)(last_mouse.y < 0 ? 0 : last_mouse.y));
+        write_varint((uint64_t)last_mouse.bstate);
+    }
+    events++;
+    return ch;
+}
+
+int session_getmouse(MEVENT* event) {
+    if (last_mouse_status == OK) {
+        *event = last_mouse;
+    }
+    return last_mouse_status;
+}
+
+bool session_replaying() {
+    return mode == SESSION_REPLAY;
+}
+
+bool session_finished() {
+    return finished;
+}
+
+uint64_t session_event_count() {
+    return events;
+}
@@ -0,0 +1,459 @@
+#include "tablebase.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+// 名字中的棋子字母，按类型从大到小
+static const char tb_letters[] = "QRBNP";
+
+typedef struct {
+    const uint8_t* base;
+    size_t length;
+    const TbHeader* header;
+    const uint64_t* offsets;
+    const uint8_t* data;
+} TbFile;
+
+typedef struct {
+    TbLayout layout;
+    TbFile files[2];    // 下标为 TB_KIND_*
+} TbEntry;
+
+// 按子力键（白方、黑方各 20 位，每种棋子 4 位计数）索引已加载的表
+static std::unordered_map<uint64_t, TbEntry> tables;
+static int loaded_max_pieces = 0;
+
+// 白王所在区域的编号，不在区域内为 -1；*_square 反过来由编号查格子。编译期生成
+struct TbSlots {
+    int8_t pawnless_slot[64];
+    int8_t pawn_slot[64];
+    int8_t pawnless_square[10];
+    int8_t pawn_square[32];
+};
+
+constexpr TbSlots make_slots() {
+    TbSlots t = {};
+    int pawnless = 0, pawns = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        int y = SQ_Y(sq), x = SQ_X(sq);
+        t.pawnless_slot[sq] = -1;
+        t.pawn_slot[sq] = -1;
+        if (x <= 3 && y <= x) {
+            t.pawnless_square[pawnless] = (int8_t)sq;
+            t.pawnless_slot[sq] = (int8_t)pawnless++;
+        }
+        if (x <= 3) {
+            t.pawn_square[pawns] = (int8_t)sq;
+            t.pawn_slot[sq] = (int8_t)pawns++;
+        }
+    }
+    return t;
+}
+
+static constexpr TbSlots tb_slots = make_slots();
+
+static constexpr const int8_t (&pawnless_slot)[64] = tb_slots.pawnless_slot;
+static constexpr const int8_t (&pawn_slot)[64] = tb_slots.pawn_slot;
+static constexpr const int8_t (&pawnless_square)[10] = tb_slots.pawnless_square;
+static constexpr const int8_t (&pawn_square)[32] = tb_slots.pawn_square;
+
+static int letter_type(char c) {
+    const char* p = strchr(tb_letters, c);
+    return c && p ? QUEEN - (int)(p - tb_letters) : EMPTY;
+}
+
+// 一方除王以外的子力，每种棋子 4 位计数
+static uint32_t side_key(const int8_t* types, int count) {
+    uint32_t key = 0;
+    for (int i = 0; i < count; i++) {
+        key += 1u << (4 * (types[i] - 1));
+    }
+    return key;
+}
+
+static uint32_t side_key(const Position& pos, int s) {
+    uint32_t key = 0;
+    for (int type = PAWN; type <= QUEEN; type++) {
+        key += (uint32_t)popcount(pos.pieces(s, type)) << (4 * (type - 1));
+    }
+    return key;
+}
+
+// 解析 "K" 加棋子字母，棋子按类型从大到小排好；返回棋子数，格式不对时返回 -1
+static int parse_side(const char*& p, int8_t* types) {
+    if (*p++ != 'K') {
+        return -1;
+    }
+    int n = 0;
+    while (letter_type(*p) != EMPTY) {
+        if (n >= TB_MAX_PIECES - 2) {
+            return -1;
+        }
+        types[n++] = (int8_t)letter_type(*p++);
+    }
+    std::sort(types, types + n, [](int8_t a, int8_t b) { return a > b; });
+    return n;
+}
+
+static void side_name(const int8_t* types, int count, char*& out) {
+    *out++ = 'K';
+    for (int i = 0; i < count; i++) {
+        *out++ = tb_letters[QUEEN - types[i]];
+    }
+}
+
+// 子力总值大的一方算强，相等时比较从大到小排好的棋子类型
+static bool stronger(const int8_t* a, int na, const int8_t* b, int nb) {
+    int va = 0, vb = 0;
+    for (int i = 0; i < na; i++) va += get_piece_value(a[i]);
+    for (int i = 0; i < nb; i++) vb += get_piece_value(b[i]);
+    if (va != vb) {
+        return va > vb;
+    }
+    return std::lexicographical_compare(b, b + nb, a, a + na);
+}
+
+bool tb_canonical_name(const char* name, char* out) {
+    int8_t white[TB_MAX_PIECES], black[TB_MAX_PIECES];
+    const char* p = name;
+    int nw = parse_side(p, white);
+    if (nw < 0 || *p++ != 'v') {
+        return false;
+    }
+    int nb = parse_side(p, black);
+    if (nb < 0 || *p != '\0' || nw + nb + 2 > TB_MAX_PIECES) {
+        return false;
+    }
+    bool swap = stronger(black, nb, white, nw);
+    side_name(swap ? black : white, swap ? nb : nw, out);
+    *out++ = 'v';
+    side_name(swap ? white : black, swap ? nw : nb, out);
+    *out = '\0';
+    return true;
+}
+
+bool tb_layout(const char* name, TbLayout& layout) {
+    int8_t white[TB_MAX_PIECES], black[TB_MAX_PIECES];
+    const char* p = name;
+    int nw = parse_side(p, white);
+    if (nw < 0 || *p++ != 'v') {
+        return false;
+    }
+    int nb = parse_side(p, black);
+    if (nb < 0 || *p != '\0' || nw + nb + 2 > TB_MAX_PIECES) {
+        return false;
+    }
+    memset(&layout, 0, sizeof(layout));
+    snprintf(layout.name, sizeof(layout.name), "%s", name);
+    layout.pieces[layout.count++] = KING;
+    layout.pieces[layout.count++] = -KING;
+    for (int i = 0; i < nw; i++) layout.pieces[layout.count++] = white[i];
+    for (int i = 0; i < nb; i++) layout.pieces[layout.count++] = (int8_t)-black[i];
+    for (int i = 2; i < layout.count; i++) {
+        layout.pawns |= abs(layout.pieces[i]) == PAWN;
+    }
+    layout.king_slots = layout.pawns ? 32 : 10;
+    layout.half_size = (uint64_t)layout.king_slots * 64;
+    for (int i = 2; i < layout.count; i++) {
+        layout.half_size *= 64;
+    }
+    layout.size = layout.half_size * 2;
+    return true;
+}
+
+// 第 0 位左右翻转，第 1 位上下翻转，第 2 位沿对角线翻转；有兵时只用左右翻转
+static int transform(int sq, int t) {
+    int y = SQ_Y(sq), x = SQ_X(sq);
+    if (t & 1) x = 7 - x;
+    if (t & 2) y = 7 - y;
+    if (t & 4) {
+        int tmp = x; x = y; y = tmp;
+    }
+    return SQ(y, x);
+}
+
+// squares 按布局的棋子顺序排列；同种棋子的格子排序后编码，交换它们得到同一个下标
+static uint64_t index_of(const TbLayout& layout, const int* squares, bool first_to_move) {
+    const int8_t* slots = layout.pawns ? pawn_slot : pawnless_slot;
+    uint64_t best = UINT64_MAX;
+    for (int t = 0; t < (layout.pawns ? 2 : 8); t++) {
+        int slot = slots[transform(squares[0], t)];
+        if (slot < 0) {
+            continue;
+        }
+        int s[TB_MAX_PIECES];
+        for (int i = 1; i < layout.count; i++) {
+            s[i] = transform(squares[i], t);
+            for (int j = i; j > 2 && layout.pieces[j - 1] == layout.pieces[j] && s[j - 1] > s[j]; j--) {
+                std::swap(s[j - 1], s[j]);
+            }
+        }
+        uint64_t index = slot;
+        for (int i = 1; i < layout.count; i++) {
+            index = index * 64 + s[i];
+        }
+        best = std::min(best, index);
+    }
+    return best + (first_to_move ? 0 : layout.half_size);
+}
+
+// flipped 时局面的黑方对应布局的白方，格子上下翻转
+static void gather_squares(const TbLayout& layout, const Position& pos, bool flipped, int* squares) {
+    Bitboard taken = 0;
+    for (int i = 0; i < layout.count; i++) {
+        int piece = flipped ? -layout.pieces[i] : layout.pieces[i];
+        Bitboard b = pos.pieces(piece > 0 ? 1 : -1, abs(piece)) & ~taken;
+        int sq = lsb(b);
+        taken |= BIT(sq);
+        squares[i] = flipped ? sq ^ 56 : sq;
+    }
+}
+
+uint64_t tb_index(const TbLayout& layout, const Position& pos) {
+    int squares[TB_MAX_PIECES];
+    gather_squares(layout, pos, false, squares);
+    return index_of(layout, squares, pos.side > 0);
+}
+
+bool tb_decode(const TbLayout& layout, uint64_t index, Position& pos) {
+    bool first_to_move = index < layout.half_size;
+    uint64_t rest = index % layout.half_size;
+    int squares[TB_MAX_PIECES];
+    for (int i = layout.count - 1; i >= 1; i--) {
+        squares[i] = (int)(rest % 64);
+        rest /= 64;
+    }
+    squares[0] = layout.pawns ? pawn_square[rest] : pawnless_square[rest];
+
+    pos.clear();
+    for (int i = 0; i < layout.count; i++) {
+        int piece = layout.pieces[i];
+        int y = SQ_Y(squares[i]);
+        // 兵不会出现在己方底线上
+        if (pos.squares[squares[i]] != EMPTY || (piece == PAWN && y == 7) || (piece == -PAWN && y == 0)) {
+            return false;
+        }
+        pos.put_piece(squares[i], piece);
+    }
+    pos.side = first_to_move ? 1 : -1;
+    return index_of(layout, squares, first_to_move) == index;
+}
+
+// 游程编码：每段为（长度 - 1，值）两个字节；非法局面不会被查询，并入当前段
+bool tb_write(const char* path, const TbLayout& layout, int kind, const uint8_t* values) {
+    TbHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TB_MAGIC;
+    header.kind = (uint32_t)kind;
+    snprintf(header.name, sizeof(header.name), "%s", layout.name);
+    header.size = layout.size;
+    header.block_size = TB_BLOCK_SIZE;
+    header.block_count = (uint32_t)((layout.size + TB_BLOCK_SIZE - 1) / TB_BLOCK_SIZE);
+
+    std::vector<uint64_t> offsets;
+    std::vector<uint8_t> data;
+    uint8_t last = kind == TB_KIND_DTM ? TB_DRAW : TB_DRAW_WDL;
+    for (uint64_t start = 0; start < layout.size; start += TB_BLOCK_SIZE) {
+        offsets.push_back(data.size());
+        uint64_t end = std::min(start + TB_BLOCK_SIZE, layout.size);
+        uint64_t i = start;
+        while (i < end) {
+            uint8_t value = values[i] == TB_ILLEGAL ? last : values[i];
+            int run = 1;
+            while (i + run < end && run < 256 && (values[i + run] == value || values[i + run] == TB_ILLEGAL)) {
+                run++;
+            }
+            data.push_back((uint8_t)(run - 1));
+            data.push_back(value);
+            last = value;
+            i += run;
+        }
+    }
+    offsets.push_back(data.size());
+
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+           && fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), out) == offsets.size()
+           && fwrite(data.data(), 1, data.size(), out) == data.size();
+    return fclose(out) == 0 && ok;
+}
+
+static bool load_file(const char* path) {
+    const char* dot = strrchr(path, '.');
+    if (!dot || (strcmp(dot, ".dtm") != 0 && strcmp(dot, ".wdl") != 0)) {
+        return false;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TbHeader)) {
+        close(fd);
+        return false;
+    }
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+
+    TbFile file;
+    file.base = (const uint8_t*)base;
+    file.length = st.st_size;
+    file.header = (const TbHeader*)base;
+    file.offsets = (const uint64_t*)(file.base + sizeof(TbHeader));
+    file.data = (const uint8_t*)(file.offsets + file.header->block_count + 1);
+
+    TbLayout layout;
+    const TbHeader& h = *file.header;
+    char name[TB_NAME_SIZE];
+    memcpy(name, h.name, TB_NAME_SIZE);
+    name[TB_NAME_SIZE - 1] = '\0';
+    size_t table_end = sizeof(TbHeader) + (h.block_count + 1) * sizeof(uint64_t);
+    bool valid = h.magic == TB_MAGIC && h.kind <= TB_KIND_DTM && tb_layout(name, layout)
+              && h.size == layout.size && h.block_size > 0
+              && h.block_count == (layout.size + h.block_size - 1) / h.block_size
+              && table_end <= file.length && table_end + file.offsets[h.block_count] <= file.length;
+    if (!valid) {
+        munmap(base, st.st_size);
+        return false;
+    }
+
+    // 表按白方为强的一方生成，键的高 20 位为白方
+    uint64_t key = 0;
+    int8_t types[2][TB_MAX_PIECES];
+    int counts[2] = {0, 0};
+    for (int i = 2; i < layout.count; i++) {
+        int c = layout.pieces[i] > 0 ? 0 : 1;
+        types[c][counts[c]++] = (int8_t)abs(layout.pieces[i]);
+    }
+    key = ((uint64_t)side_key(types[0], counts[0]) << 20) | side_key(types[1], counts[1]);
+
+    TbEntry& entry = tables[key];
+    entry.layout = layout;
+    TbFile& slot = entry.files[h.kind];
+    if (slot.base) {
+        munmap((void*)slot.base, slot.length);
+    }
+    slot = file;
+    loaded_max_pieces = std::max(loaded_max_pieces, layout.count);
+    return true;
+}
+
+int tb_load(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return 0;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return load_file(path) ? 1 : 0;
+    }
+    DIR* dir = opendir(path);
+    if (!dir) {
+        return 0;
+    }
+    int loaded = 0;
+    while (struct dirent* e = readdir(dir)) {
+        std::string file = std::string(path) + "/" + e->d_name;
+        loaded += load_file(file.c_str()) ? 1 : 0;
+    }
+    closedir(dir);
+    return loaded;
+}
+
+void tb_unload() {
+    for (auto& it : tables) {
+        for (int k = 0; k < 2; k++) {
+            if (it.second.files[k].base) {
+                munmap((void*)it.second.files[k].base, it.second.files[k].length);
+            }
+        }
+    }
+    tables.clear();
+    loaded_max_pieces = 0;
+}
+
+int tb_max_pieces() {
+    return loaded_max_pieces;
+}
+
+// 找到块的起点后顺着游程往后数
+static int read_value(const TbFile& file, uint64_t index) {
+    uint64_t block = index / file.header->block_size;
+    uint32_t offset = (uint32_t)(index % file.header->block_size);
+    const uint8_t* p = file.data + file.offsets[block];
+    uint32_t start = 0;
+    while (offset >= start + p[0] + 1u) {
+        start += p[0] + 1u;
+        p += 2;
+    }
+    return p[1];
+}
+
+static bool probe_value(const Position& pos, int kind, int& value) {
+    if (popcount(pos.occupied()) > loaded_max_pieces) {
+        return false;
+    }
+    uint32_t white = side_key(pos, 1), black = side_key(pos, -1);
+    bool flipped = false;
+    auto it = tables.find(((uint64_t)white << 20) | black);
+    if (it == tables.end()) {
+        it = tables.find(((uint64_t)black << 20) | white);
+        flipped = true;
+        if (it == tables.end()) {
+            return false;
+        }
+    }
+    const TbFile& file = it->second.files[kind];
+    if (!file.base) {
+        return false;
+    }
+    int squares[TB_MAX_PIECES];
+    gather_squares(it->second.layout, pos, flipped, squares);
+    value = read_value(file, index_of(it->second.layout, squares, (pos.side > 0) != flipped));
+    return true;
+}
+
+bool tb_probe_dtm(const Position& pos, int& wdl, int& plies) {
+    int value;
+    if (popcount(pos.occupied()) == 2) {
+        value = TB_DRAW;
+    } else if (!probe_value(pos, TB_KIND_DTM, value)) {
+        return false;
+    }
+    if (value >= TB_DRAW) {
+        wdl = TB_DRAW_WDL;
+        plies = 0;
+    } else {
+        wdl = (value & 1) ? TB_WIN : TB_LOSS;
+        plies = value;
+    }
+    return true;
+}
+
+bool tb_probe_wdl(const Position& pos, int& wdl) {
+    if (popcount(pos.occupied()) == 2) {
+        wdl = TB_DRAW_WDL;
+        return true;
+    }
+    int value;
+    if (probe_value(pos, TB_KIND_WDL, value)) {
+        wdl = value;
+        return true;
+    }
+    int plies;
+    return tb_probe_dtm(pos, wdl, plies);
+}
@@ -0,0 +1,67 @@
+#include "time_manager.h"
+#include "search.h"
+#include <algorithm>
+
+#define MOVE_OVERHEAD_MS 30   // 留给界面与系统调度的余量
+#define DEFAULT_MOVES_TO_GO 30
+
+void TimeManager::start(const SearchLimits& limits) {
+    last_best = MOVE_NONE;
+    last_score = 0;
+    stable_iterations = 0;
+    instability = 0;
+    fail_low_factor = 1.0;
+
+    if (limits.clock_ms > 0) {
+        // 把剩余时间平均分给预计还要走的步数，加上大部分加秒
+        double remaining = std::max(limits.clock_ms - MOVE_OVERHEAD_MS, 1);
+        int moves_to_go = limits.moves_to_go > 0 ? std::min(limits.moves_to_go, DEFAULT_MOVES_TO_GO)
+                                                 : DEFAULT_MOVES_TO_GO;
+        soft_ms = remaining / moves_to_go + limits.increment_ms * 0.75;
+        hard_ms = std::min(remaining * 0.25, soft_ms * 3);
+        soft_ms = std::min(soft_ms, hard_ms);
+        enabled = true;
+        adaptive = true;
+    } else if (limits.time_ms > 0) {
+        soft_ms = hard_ms = limits.time_ms;
+        enabled = true;
+        adaptive = false;
+    } else {
+        soft_ms = hard_ms = 0;
+        enabled = false;
+        adaptive = false;
+    }
+}
+
+bool TimeManager::stop_after_iteration(double elapsed_ms, int depth, MoveCode best, int score, double best_share) {
+    if (!enabled) {
+        return false;
+    }
+    if (!adaptive) {
+        return elapsed_ms >= hard_ms;
+    }
+
+    instability *= 0.5;
+    if (depth > 1 && best != last_best) {
+        instability += 1.0;
+        stable_iterations = 0;
+    } else {
+        stable_iterations++;
+    }
+    // 分数比上一轮明显下降（fail low），多给一些时间寻找补救
+    if (depth > 1 && score < last_score - 30) {
+        fail_low_factor = std::min(fail_low_factor * 1.5, 3.0);
+    }
+    last_best = best;
+    last_score = score;
+
+    double factor = (1.0 + instability) * fail_low_factor;
+    // 最佳走法连续稳定、且占用了绝大部分节点，说明它明显优于其他走法
+    if (stable_iterations >= 3 && best_share >= 0.85) {
+        factor *= 0.5;
+    }
+    double budget = std::min(soft_ms * factor, hard_ms);
+
+    // 下一轮通常比这一轮耗时更多，剩余预算不足一半时就不再开始
+    return elapsed_ms >= budget * 0.5;
+}
@@ -0,0 +1,144 @@
+#include "tt.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+// 小于这个大小的表由一个线程单独清零，不值得分给其他线程
+#define PARALLEL_CLEAR_MIN (64UL << 20)
+
+// data 布局：move 16 位 | score 16 位 | depth 8 位 | bound 8 位 | generation 8 位
+static uint64_t pack(MoveCode move, int score, int depth, int bound, int generation) {
+    return (uint64_t)move
+         | ((uint64_t)(uint16_t)(int16_t)score << 16)
+         | ((uint64_t)(uint8_t)depth << 32)
+         | ((uint64_t)bound << 40)
+         | ((uint64_t)generation << 48);
+}
+
+static int slot_depth(uint64_t data) { return (int8_t)(data >> 32); }
+static int slot_generation(uint64_t data) { return (data >> 48) & 0xFF; }
+
+TranspositionTable::~TranspositionTable() {
+    release();
+}
+
+void TranspositionTable::release() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+    mapping = NULL;
+    mapping_size = 0;
+    slots = NULL;
+}
+
+void TranspositionTable::resize(size_t mb) {
+    release();
+    size_t buckets = 1;
+    while ((buckets * 2) * TT_BUCKET_SIZE * sizeof(TTSlot) <= (mb << 20)) {
+        buckets *= 2;
+    }
+    size_t bytes = buckets * TT_BUCKET_SIZE * sizeof(TTSlot);
+    pages = TT_PAGES_NORMAL;
+
+    // 先尝试 hugetlbfs 预留的大页，没有预留或不够时退回普通映射，再建议内核用透明大页
+#ifdef MAP_HUGETLB
+    if (bytes >= HUGE_PAGE_SIZE) {
+        mapping_size = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = NULL;
+        } else {
+            pages = TT_PAGES_HUGE;
+            slots = (TTSlot*)mapping;
+        }
+    }
+#endif
+    if (!mapping) {
+        // 多映射一个大页的长度，把起点对齐到大页边界，透明大页才能覆盖整张表
+        mapping_size = bytes >= HUGE_PAGE_SIZE ? bytes + HUGE_PAGE_SIZE : bytes;
+        mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            mapping = NULL;
+            throw std::bad_alloc();
+        }
+        uintptr_t base = (uintptr_t)mapping;
+        if (bytes >= HUGE_PAGE_SIZE) {
+            base = (base + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+#ifdef MADV_HUGEPAGE
+            if (madvise((void*)base, bytes, MADV_HUGEPAGE) == 0) {
+                pages = TT_PAGES_TRANSPARENT;
+            }
+#endif
+        }
+        slots = (TTSlot*)base;
+    }
+    bucket_mask = buckets - 1;
+    generation = 0;
+}
+
+void TranspositionTable::clear_slice(int index, int count) {
+    size_t bytes = (bucket_mask + 1) * TT_BUCKET_SIZE * sizeof(TTSlot);
+    if (count <= 1 || bytes < PARALLEL_CLEAR_MIN) {
+        if (index == 0) {
+            memset(slots, 0, bytes);
+            generation = 0;
+        }
+        return;
+    }
+    size_t chunks = bytes / HUGE_PAGE_SIZE;
+    size_t begin = chunks * index / count * HUGE_PAGE_SIZE;
+    size_t end = chunks * (index + 1) / count * HUGE_PAGE_SIZE;
+    memset((char*)slots + begin, 0, end - begin);
+    if (index == 0) {
+        generation = 0;
+    }
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry) const {
+    const TTSlot* bucket = slots + (key & bucket_mask) * TT_BUCKET_SIZE;
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&bucket[i].key, __ATOMIC_RELAXED);
+        if ((check ^ data) == key && data != 0) {
+            entry.move = (MoveCode)(data & 0xFFFF);
+            entry.score = (int16_t)(data >> 16);
+            entry.depth = slot_depth(data);
+            entry.bound = (data >> 40) & 0xFF;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, MoveCode move, int score, int depth, int bound) {
+    TTSlot* bucket = slots + (key & bucket_mask) * TT_BUCKET_SIZE;
+
+    // 优先覆盖同一局面，否则替换最旧、最浅的条目
+    TTSlot* replace = bucket;
+    int worst = 1 << 30;
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        uint64_t data = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&bucket[i].key, __ATOMIC_RELAXED);
+        if ((check ^ data) == key) {
+            // 同一局面保留已有的走法，除非新条目带了走法
+            if (move == MOVE_NONE) {
+                move = (MoveCode)(data & 0xFFFF);
+            }
+            replace = &bucket[i];
+            break;
+        }
+        int age = (generation - slot_generation(data)) & 0xFF;
+        int value = slot_depth(data) - age * 8;
+        if (value < worst) {
+            worst = value;
+            replace = &bucket[i];
+        }
+    }
+
+    uint64_t data = pack(move, score, depth, bound, generation);
+    __atomic_store_n(&replace->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&replace->key, key ^ data, __ATOMIC_RELAXED);
+}
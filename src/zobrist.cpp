@@ -0,0 +1,16 @@
+#include "zobrist.h"
+
+uint64_t compute_board_key(const int b[8][8], int side) {
+    uint64_t key = 0;
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            if (b[i][j] != 0) {
+                key ^= zobrist_piece(b[i][j], i * 8 + j);
+            }
+        }
+    }
+    if (side < 0) {
+        key ^= zobrist_side;
+    }
+    return key;
+}
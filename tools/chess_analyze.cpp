@@ -0,0 +1,325 @@
+// 批量分析工具：从 FEN / EPD 文件流式读入局面，分给工作线程搜索（每个线程一个引擎和置换表），
+// 按输入顺序每行输出一个 JSON 结果。各线程有自己的任务队列，空了就从别的线程队尾偷任务；
+// 同时在途的局面数有上限，读入方在窗口满时等待，所以内存占用与输入大小无关
+#include "search.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LINE_SIZE 1024
+
+typedef struct {
+    uint64_t index;         // 输入中的序号（只计有效行）
+    std::string line;
+} Task;
+
+// 每个工作线程的任务队列：自己从队头取最早的任务，别的线程从队尾偷
+typedef struct {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+} WorkQueue;
+
+typedef struct {
+    SearchLimits limits;
+    int threads;
+    size_t hash_mb;
+    bool keep_hash;
+    size_t window;          // 在途局面上限
+    FILE* out;
+
+    std::vector<WorkQueue> queues;
+    std::mutex idle_mutex;
+    std::condition_variable work_ready;   // 有新任务或输入结束
+    std::atomic<size_t> queued;
+    bool input_done;
+
+    // 结果按序号放进环形缓冲区，轮到的那个线程负责把连续完成的结果依次写出
+    std::mutex output_mutex;
+    std::condition_variable window_free;
+    std::vector<std::string> results;
+    std::vector<bool> finished;
+    uint64_t next_output;
+
+    std::atomic<uint64_t> nodes;
+    std::atomic<uint64_t> steals;
+} AnalyzeShared;
+
+static bool pop_own(WorkQueue& q, Task& task) {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = std::move(q.tasks.front());
+    q.tasks.pop_front();
+    return true;
+}
+
+static bool steal(WorkQueue& q, Task& task) {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+}
+
+// 取下一个任务：先看自己的队列，再依次偷其他线程的；都空时等待，输入结束且无任务时返回 false
+static bool next_task(AnalyzeShared* shared, int id, Task& task) {
+    int n = shared->threads;
+    while (true) {
+        if (pop_own(shared->queues[id], task)) {
+            shared->queued--;
+            return true;
+        }
+        for (int i = 1; i < n; i++) {
+            if (steal(shared->queues[(id + i) % n], task)) {
+                shared->queued--;
+                shared->steals++;
+                return true;
+            }
+        }
+        std::unique_lock<std::mutex> lock(shared->idle_mutex);
+        shared->work_ready.wait(lock, [shared]() { return shared->queued > 0 || shared->input_done; });
+        if (shared->queued == 0 && shared->input_done) {
+            return false;
+        }
+    }
+}
+
+static void append_escaped(std::string& out, const char* text) {
+    for (const char* p = text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            out += '\\';
+        }
+        if ((unsigned char)*p >= 0x20) {
+            out += *p;
+        }
+    }
+}
+
+// EPD 的 id 操作码，例如 id "WAC.001";
+static bool epd_id(const std::string& line, std::string& id) {
+    size_t at = line.find(" id \"");
+    if (at == std::string::npos) {
+        return false;
+    }
+    size_t begin = at + 5;
+    size_t end = line.find('"', begin);
+    if (end == std::string::npos) {
+        return false;
+    }
+    id = line.substr(begin, end - begin);
+    return true;
+}
+
+static std::string analyze_line(AnalyzeShared* shared, Engine& engine, const Task& task) {
+    char buf[256];
+    std::string json;
+    snprintf(buf, sizeof(buf), "{\"index\":%llu", (unsigned long long)task.index);
+    json += buf;
+    std::string id;
+    if (epd_id(task.line, id)) {
+        json += ",\"id\":\"";
+        append_escaped(json, id.c_str());
+        json += "\"";
+    }
+
+    Position pos;
+    if (!pos.set_fen_strict(task.line.c_str())) {
+        json += ",\"error\":\"bad fen\",\"input\":\"";
+        append_escaped(json, task.line.c_str());
+        json += "\"}";
+        return json;
+    }
+    char fen[128];
+    pos.to_fen(fen);
+    json += ",\"fen\":\"";
+    json += fen;
+    json += "\"";
+
+    if (!shared->keep_hash) {
+        engine.new_game();
+    }
+    SearchResult r = engine.search(pos, shared->limits);
+    uint64_t nodes = engine.last_stats().nodes;
+    shared->nodes += nodes;
+    if (r.best_move == MOVE_NONE) {
+        int status = position_status(pos);
+        json += status == STATUS_CHECKMATE ? ",\"result\":\"checkmate\"}" : ",\"result\":\"stalemate\"}";
+        return json;
+    }
+
+    char move[8];
+    move_to_string(r.best_move, move);
+    snprintf(buf, sizeof(buf), ",\"best\":\"%s\",\"score\":%d", move, r.score);
+    json += buf;
+    if (abs(r.score) >= SCORE_MATE_IN_MAX) {
+        int moves = (SCORE_MATE - abs(r.score) + 1) / 2;
+        snprintf(buf, sizeof(buf), ",\"mate\":%d", r.score > 0 ? moves : -moves);
+        json += buf;
+    }
+    snprintf(buf, sizeof(buf), ",\"depth\":%d,\"nodes\":%llu,\"pv\":[", r.depth, (unsigned long long)nodes);
+    json += buf;
+    for (int i = 0; i < r.pv_length; i++) {
+        move_to_string(r.pv[i], move);
+        json += i ? ",\"" : "\"";
+        json += move;
+        json += "\"";
+    }
+    json += "]}";
+    return json;
+}
+
+static void worker_main(AnalyzeShared* shared, int id) {
+    Engine engine;
+    engine.set_hash(shared->hash_mb);
+    Task task;
+    while (next_task(shared, id, task)) {
+        std::string json = analyze_line(shared, engine, task);
+
+        std::lock_guard<std::mutex> lock(shared->output_mutex);
+        size_t slot = task.index % shared->window;
+        shared->results[slot].swap(json);
+        shared->finished[slot] = true;
+        bool advanced = false;
+        while (true) {
+            size_t next = shared->next_output % shared->window;
+            if (!shared->finished[next]) {
+                break;
+            }
+            fputs(shared->results[next].c_str(), shared->out);
+            fputc('\n', shared->out);
+            std::string().swap(shared->results[next]);
+            shared->finished[next] = false;
+            shared->next_output++;
+            advanced = true;
+        }
+        if (advanced) {
+            shared->window_free.notify_one();
+        }
+    }
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: chess_analyze [-j threads] [--depth N] [--nodes N] [--movetime MS] [--hash MB]\n"
+            "                     [--keep-hash] [--window N] [-o out.jsonl] [positions.epd]\n");
+}
+
+int main(int argc, char** argv) {
+    AnalyzeShared* shared = new AnalyzeShared();
+    memset(&shared->limits, 0, sizeof(shared->limits));
+    shared->threads = std::thread::hardware_concurrency();
+    shared->hash_mb = 16;
+    shared->keep_hash = false;
+    shared->window = 0;
+    const char* input = NULL;
+    const char* output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) shared->threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) shared->limits.depth = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) shared->limits.nodes = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--movetime") == 0 && i + 1 < argc) shared->limits.time_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) shared->hash_mb = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--keep-hash") == 0) shared->keep_hash = true;
+        else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) shared->window = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+        else if (argv[i][0] == '-' && argv[i][1] != '\0') { usage(); return 1; }
+        else input = argv[i];
+    }
+    if (shared->threads <= 0) shared->threads = 1;
+    // 没有给出任何限制时默认 8 层
+    if (!shared->limits.depth && !shared->limits.nodes && !shared->limits.time_ms) {
+        shared->limits.depth = 8;
+    }
+    if (shared->window == 0) {
+        shared->window = 64 * (size_t)shared->threads;
+    }
+
+    FILE* in = input && strcmp(input, "-") != 0 ? fopen(input, "r") : stdin;
+    if (!in) {
+        fprintf(stderr, "chess_analyze: cannot open %s\n", input);
+        return 1;
+    }
+    shared->out = output ? fopen(output, "w") : stdout;
+    if (!shared->out) {
+        fprintf(stderr, "chess_analyze: cannot write %s\n", output);
+        return 1;
+    }
+
+    shared->queues = std::vector<WorkQueue>(shared->threads);
+    shared->queued = 0;
+    shared->input_done = false;
+    shared->results.assign(shared->window, std::string());
+    shared->finished.assign(shared->window, false);
+    shared->next_output = 0;
+    shared->nodes = 0;
+    shared->steals = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < shared->threads; i++) {
+        workers.push_back(std::thread(worker_main, shared, i));
+    }
+
+    // 主线程读入，轮流放进各线程的队列；空行和 # 开头的行跳过
+    char line[LINE_SIZE];
+    uint64_t count = 0;
+    while (fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        {
+            std::unique_lock<std::mutex> lock(shared->output_mutex);
+            shared->window_free.wait(lock, [shared, count]() { return count - shared->next_output < shared->window; });
+        }
+        Task task;
+        task.index = count;
+        task.line = line;
+        WorkQueue& q = shared->queues[count % shared->threads];
+        {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(std::move(task));
+        }
+        count++;
+        {
+            std::lock_guard<std::mutex> lock(shared->idle_mutex);
+            shared->queued++;
+        }
+        shared->work_ready.notify_one();
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    {
+        std::lock_guard<std::mutex> lock(shared->idle_mutex);
+        shared->input_done = true;
+    }
+    shared->work_ready.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    if (shared->out != stdout) {
+        fclose(shared->out);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t nodes = shared->nodes;
+    fprintf(stderr, "%llu positions, %d threads, %.1f s, %.1f positions/s, %.0f nodes/s, %llu steals\n",
+            (unsigned long long)count, shared->threads, seconds, count / std::max(seconds, 1e-9),
+            nodes / std::max(seconds, 1e-9), (unsigned long long)shared->steals.load());
+    delete shared;
+    return 0;
+}
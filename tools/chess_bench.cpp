@@ -0,0 +1,387 @@
+// 规则与评估热点函数的微基准：固定局面集合，预热 + 多次重复，输出 ns/op、ops/sec 与标准差
+#include "bitboard.h"
+#include "cpu.h"
+#include "evaluate.h"
+#include "game.h"
+#include "piece.h"
+#include "position.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef struct {
+    const char* category;
+    const char* fen;
+} BenchPosition;
+
+// 每类两到三个局面：开局、中局、残局、被将军
+static const BenchPosition corpus[] = {
+    {"opening",    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1"},
+    {"opening",    "rnbqkb1r/pppp1ppp/5n2/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w - - 2 3"},
+    {"opening",    "r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b - - 3 3"},
+    {"middlegame", "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w - - 0 8"},
+    {"middlegame", "r2q1rk1/1b1nbppp/p2ppn2/1p6/3NP3/1BN1B3/PPP1QPPP/R4RK1 w - - 0 11"},
+    {"middlegame", "2rq1rk1/pb1nbppp/1p2pn2/2p5/2PP4/1PN1PN2/PB2BPPP/2RQ1RK1 b - - 0 12"},
+    {"endgame",    "8/5k2/3p4/1p1P4/1P3K2/8/8/8 w - - 0 1"},
+    {"endgame",    "8/8/4kp2/8/3R4/5K2/5P2/8 w - - 0 1"},
+    {"endgame",    "6k1/5pp1/8/8/8/8/5PP1/3R2K1 b - - 0 1"},
+    {"check",      "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w - - 1 3"},
+    {"check",      "r3k2r/8/8/8/4Q3/8/8/R3K2R b - - 0 1"},
+    {"check",      "r1bqkbnr/pppp1Qpp/2n5/4p3/2B1P3/8/PPPP1PPP/RNB1K1NR b - - 0 4"},
+};
+
+static const int corpus_size = sizeof(corpus) / sizeof(corpus[0]);
+
+// 每个局面预先准备的参数，计时过程中只调用被测函数
+typedef struct {
+    int cells[8][8];
+    int side;
+    std::vector<int> pairs;   // from * 64 + to，包括合法与不合法的组合
+    std::vector<int> pieces;  // 有棋子的格子
+    std::vector<Position> leaves;   // 批量评估用：局面本身和往下展开的后继局面
+    EvalBatch* batch;         // 同一组 leaves 的结构数组布局
+} PreparedPosition;
+
+#define BATCH_LEAVES 256
+
+static std::vector<PreparedPosition> prepared;
+static volatile int sink;
+
+static void load_board(const PreparedPosition& p) {
+    memcpy(board, p.cells, sizeof(board));
+}
+
+typedef long (*Kernel)(const PreparedPosition& p);
+
+// 每个内核返回本次执行的调用次数
+static long run_is_legal_move(const PreparedPosition& p) {
+    int acc = 0;
+    for (size_t i = 0; i < p.pairs.size(); i++) {
+        int from = p.pairs[i] >> 6, to = p.pairs[i] & 63;
+        acc += is_legal_move(SQ_Y(from), SQ_X(from), SQ_Y(to), SQ_X(to));
+    }
+    sink = acc;
+    return p.pairs.size();
+}
+
+static long run_is_attacked(const PreparedPosition& p) {
+    int acc = 0;
+    for (int sq = 0; sq < 64; sq++) {
+        acc += is_attacked(SQ_Y(sq), SQ_X(sq), -p.side);
+    }
+    sink = acc;
+    return 64;
+}
+
+static long run_is_in_check(const PreparedPosition& p) {
+    sink = is_in_check(p.side) + is_in_check(-p.side);
+    return 2;
+}
+
+static long run_try_move(const PreparedPosition& p) {
+    int acc = 0;
+    for (size_t i = 0; i < p.pairs.size(); i++) {
+        int from = p.pairs[i] >> 6, to = p.pairs[i] & 63;
+        acc += try_move(SQ_Y(from), SQ_X(from), SQ_Y(to), SQ_X(to));
+    }
+    sink = acc;
+    return p.pairs.size();
+}
+
+static long run_is_checkmate(const PreparedPosition& p) {
+    sink = is_checkmate(p.side);
+    return 1;
+}
+
+static long run_get_positional_score(const PreparedPosition& p) {
+    int acc = 0;
+    for (size_t i = 0; i < p.pieces.size(); i++) {
+        int sq = p.pieces[i];
+        acc += get_positional_score(p.cells[SQ_Y(sq)][SQ_X(sq)], SQ_Y(sq), SQ_X(sq));
+    }
+    sink = acc;
+    return p.pieces.size();
+}
+
+// 单个局面的通用（标量）评估内核，作为批量评估的对照
+static long run_evaluate_scalar(const PreparedPosition& p) {
+    int acc = 0;
+    for (size_t i = 0; i < p.leaves.size(); i++) {
+        acc += evaluate_kernels[CPU_GENERIC](p.leaves[i]);
+    }
+    sink = acc;
+    return p.leaves.size();
+}
+
+// 当前选中的单局面内核（AVX2 时在一个局面内部按格向量化）
+static long run_evaluate_pieces(const PreparedPosition& p) {
+    int acc = 0;
+    for (size_t i = 0; i < p.leaves.size(); i++) {
+        acc += cpu_kernels.evaluate_pieces(p.leaves[i]);
+    }
+    sink = acc;
+    return p.leaves.size();
+}
+
+static long run_evaluate_batch(const PreparedPosition& p) {
+    int scores[BATCH_LEAVES];
+    p.batch->evaluate(scores);
+    sink = scores[0] + scores[p.batch->size() - 1];
+    return p.batch->size();
+}
+
+static Game bench_game;
+
+static long run_calculate_score(const PreparedPosition& p) {
+    (void)p;
+    sink = bench_game.calculate_score(1) - bench_game.calculate_score(-1);
+    return 2;
+}
+
+typedef struct {
+    const char* name;
+    Kernel kernel;
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+    {"is_legal_move",        run_is_legal_move},
+    {"is_attacked",          run_is_attacked},
+    {"is_in_check",          run_is_in_check},
+    {"try_move",             run_try_move},
+    {"is_checkmate",         run_is_checkmate},
+    {"get_positional_score", run_get_positional_score},
+    {"calculate_score",      run_calculate_score},
+    {"evaluate_scalar",      run_evaluate_scalar},
+    {"evaluate_pieces",      run_evaluate_pieces},
+    {"evaluate_batch",       run_evaluate_batch},
+};
+
+typedef struct {
+    std::string name;
+    std::string category;
+    long ops_per_rep;
+    int reps;
+    double mean_ns;
+    double stddev_ns;
+    double min_ns;
+} BenchResult;
+
+static double now_ns() {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 对一个类别中的全部局面执行一遍内核
+static long run_category(Kernel kernel, const char* category) {
+    long ops = 0;
+    for (int i = 0; i < corpus_size; i++) {
+        if (strcmp(corpus[i].category, category) != 0) continue;
+        load_board(prepared[i]);
+        ops += kernel(prepared[i]);
+    }
+    return ops;
+}
+
+static BenchResult measure(const Benchmark& bench, const char* category, int warmup, int reps, double min_rep_ns) {
+    // 估算每次重复需要执行多少轮，使单次重复不短于 min_rep_ns
+    long rounds = 1;
+    while (true) {
+        double start = now_ns();
+        for (long r = 0; r < rounds; r++) run_category(bench.kernel, category);
+        double elapsed = now_ns() - start;
+        if (elapsed >= min_rep_ns || rounds >= (1L << 30)) break;
+        rounds *= elapsed > 0 ? std::max(2.0, std::min(100.0, min_rep_ns / elapsed * 1.2)) : 100;
+    }
+    for (int w = 0; w < warmup; w++) {
+        for (long r = 0; r < rounds; r++) run_category(bench.kernel, category);
+    }
+
+    std::vector<double> samples;
+    long ops_per_rep = 0;
+    for (int rep = 0; rep < reps; rep++) {
+        ops_per_rep = 0;
+        double start = now_ns();
+        for (long r = 0; r < rounds; r++) ops_per_rep += run_category(bench.kernel, category);
+        samples.push_back((now_ns() - start) / ops_per_rep);
+    }
+
+    double sum = 0, min_ns = samples[0];
+    for (size_t i = 0; i < samples.size(); i++) {
+        sum += samples[i];
+        if (samples[i] < min_ns) min_ns = samples[i];
+    }
+    double mean = sum / samples.size();
+    double var = 0;
+    for (size_t i = 0; i < samples.size(); i++) {
+        var += (samples[i] - mean) * (samples[i] - mean);
+    }
+
+    BenchResult result;
+    result.name = bench.name;
+    result.category = category;
+    result.ops_per_rep = ops_per_rep;
+    result.reps = reps;
+    result.mean_ns = mean;
+    result.stddev_ns = samples.size() > 1 ? sqrt(var / (samples.size() - 1)) : 0;
+    result.min_ns = min_ns;
+    return result;
+}
+
+static const char* arch_name() {
+#if defined(__x86_64__)
+    return "x86_64";
+#elif defined(__aarch64__)
+    return "aarch64";
+#elif defined(__arm__)
+    return "arm";
+#else
+    return "unknown";
+#endif
+}
+
+static void write_json(const std::vector<BenchResult>& results, const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "chess_bench: cannot write %s\n", path);
+        return;
+    }
+    fprintf(out, "{\"arch\":\"%s\",\"compiler\":\"%s\",\"results\":[", arch_name(), __VERSION__);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(out, "%s\n{\"name\":\"%s\",\"corpus\":\"%s\",\"ns_per_op\":%.3f,\"stddev_ns\":%.3f,"
+                     "\"min_ns\":%.3f,\"ops_per_sec\":%.0f,\"reps\":%d,\"ops_per_rep\":%ld}",
+                i ? "," : "", r.name.c_str(), r.category.c_str(), r.mean_ns, r.stddev_ns,
+                r.min_ns, 1e9 / r.mean_ns, r.reps, r.ops_per_rep);
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+}
+
+static void prepare_corpus() {
+    for (int i = 0; i < corpus_size; i++) {
+        Position pos;
+        if (!pos.set_fen(corpus[i].fen)) {
+            fprintf(stderr, "chess_bench: bad FEN %s\n", corpus[i].fen);
+            exit(1);
+        }
+        PreparedPosition p;
+        pos.to_board(p.cells);
+        p.side = pos.side;
+        for (int from = 0; from < 64; from++) {
+            if (pos.squares[from] == EMPTY) continue;
+            p.pieces.push_back(from);
+            if (pos.squares[from] * pos.side <= 0) continue;
+            // 走棋方每个棋子对应攻击方向上的所有格子，既有合法走法也有被挡住的走法
+            for (int to = 0; to < 64; to++) {
+                if (to != from && (SQ_Y(to) == SQ_Y(from) || SQ_X(to) == SQ_X(from)
+                                   || abs(SQ_Y(to) - SQ_Y(from)) == abs(SQ_X(to) - SQ_X(from))
+                                   || (knight_attacks[from] & BIT(to)))) {
+                    p.pairs.push_back(from * 64 + to);
+                }
+            }
+        }
+        // 按层展开后继局面，凑满 BATCH_LEAVES 个
+        p.leaves.push_back(pos);
+        for (size_t next = 0; next < p.leaves.size() && p.leaves.size() < BATCH_LEAVES; next++) {
+            Position parent = p.leaves[next];
+            MoveCode moves[MAX_MOVES];
+            int count = generate_legal_moves(parent, moves);
+            for (int m = 0; m < count && p.leaves.size() < BATCH_LEAVES; m++) {
+                Position child = parent;
+                Undo undo;
+                child.do_move(moves[m], undo);
+                p.leaves.push_back(child);
+            }
+        }
+        p.batch = new EvalBatch(p.leaves.size());
+        for (size_t i = 0; i < p.leaves.size(); i++) {
+            p.batch->add(p.leaves[i]);
+        }
+        int scores[BATCH_LEAVES];
+        p.batch->evaluate(scores);
+        for (size_t i = 0; i < p.leaves.size(); i++) {
+            if (scores[i] != evaluate_kernels[CPU_GENERIC](p.leaves[i])) {
+                fprintf(stderr, "chess_bench: batch evaluation mismatch on %s\n", corpus[prepared.size()].fen);
+                exit(1);
+            }
+        }
+        prepared.push_back(p);
+    }
+}
+
+static const BenchResult* find_result(const std::vector<BenchResult>& results, const char* name, const std::string& category) {
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].name == name && results[i].category == category) {
+            return &results[i];
+        }
+    }
+    return NULL;
+}
+
+// 批量评估相对单局面评估的吞吐（局面/秒）之比
+static void print_batch_speedup(const std::vector<BenchResult>& results) {
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        const BenchResult* scalar = find_result(results, "evaluate_scalar", r.category);
+        const BenchResult* pieces = find_result(results, "evaluate_pieces", r.category);
+        if (r.name != "evaluate_batch" || !scalar || !pieces) {
+            continue;
+        }
+        printf("evaluate_batch %-11s %14.0f positions/sec, %5.2fx scalar, %5.2fx evaluate_pieces\n",
+               r.category.c_str(), 1e9 / r.mean_ns, scalar->mean_ns / r.mean_ns, pieces->mean_ns / r.mean_ns);
+    }
+}
+
+static void usage() {
+    fprintf(stderr, "usage: chess_bench [--reps N] [--warmup N] [--min-time-ms N] [--filter NAME] [--json FILE] [--cpu NAME]\n");
+}
+
+int main(int argc, char** argv) {
+    int reps = 10;
+    int warmup = 2;
+    double min_time_ms = 20;
+    const char* filter = NULL;
+    const char* json = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) min_time_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) filter = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json = argv[++i];
+        else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+            if (!cpu_select(argv[++i])) {
+                fprintf(stderr, "unsupported cpu variant: %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else { usage(); return 1; }
+    }
+    if (reps < 1) reps = 1;
+
+    prepare_corpus();
+
+    printf("cpu kernels: %s\n", cpu_variant_names[cpu_kernels.variant]);
+    static const char* categories[] = {"opening", "middlegame", "endgame", "check"};
+    std::vector<BenchResult> results;
+    printf("%-22s %-11s %12s %10s %14s\n", "benchmark", "corpus", "ns/op", "stddev", "ops/sec");
+    for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) {
+        if (filter && !strstr(benchmarks[b].name, filter)) continue;
+        for (int c = 0; c < 4; c++) {
+            BenchResult r = measure(benchmarks[b], categories[c], warmup, reps, min_time_ms * 1e6);
+            printf("%-22s %-11s %12.1f %9.1f%% %14.0f\n", r.name.c_str(), r.category.c_str(),
+                   r.mean_ns, r.mean_ns > 0 ? r.stddev_ns * 100 / r.mean_ns : 0, 1e9 / r.mean_ns);
+            fflush(stdout);
+            results.push_back(r);
+        }
+    }
+    print_batch_speedup(results);
+    if (json) {
+        write_json(results, json);
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+// 自对弈训练数据生成工具：每个线程一个引擎，按节点数限制搜索，
+// 把安静局面连同搜索分数和对局结果写成定长的打包记录；也可以对已有数据去重并打乱
+#include "bitboard.h"
+#include "packed_position.h"
+#include "piece.h"
+#include "search.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define MAX_GAME_PLY 300
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1"
+
+typedef struct {
+    const char* output;
+    int games;
+    uint64_t nodes;
+    int random_plies;
+    uint64_t seed;
+    std::atomic<int> next_game;
+    std::atomic<uint64_t> positions;
+    std::mutex write_mutex;
+    PackedWriter writer;
+} GeneratorShared;
+
+// 只剩双王时判和
+static bool bare_kings(const Position& pos) {
+    return popcount(pos.occupied()) == 2;
+}
+
+// 下一盘棋：先随机走几步打开局面，再由引擎自对弈到结束；返回 false 表示开局随机走进了终局
+static bool play_game(GeneratorShared* shared, Engine& engine, uint64_t& rng, std::vector<PackedPosition>& records) {
+    Position pos;
+    pos.set_fen(START_FEN);
+    MoveCode moves[MAX_MOVES];
+    for (int ply = 0; ply < shared->random_plies; ply++) {
+        int count = generate_legal_moves(pos, moves);
+        if (count == 0) {
+            return false;
+        }
+        Undo undo;
+        pos.do_move(moves[next_random(rng) % count], undo);
+    }
+
+    SearchLimits limits;
+    memset(&limits, 0, sizeof(limits));
+    limits.nodes = shared->nodes;
+    engine.new_game();
+    records.clear();
+
+    int result = 0;
+    for (int ply = 0; ply < MAX_GAME_PLY; ply++) {
+        bool in_check = pos.in_check(pos.side);
+        if (!has_legal_move(pos)) {
+            result = in_check ? -pos.side : 0;
+            break;
+        }
+        if (bare_kings(pos)) {
+            break;
+        }
+        SearchResult r = engine.search(pos, limits);
+        // 找到将杀就直接判定结果
+        if (abs(r.score) >= SCORE_MATE_IN_MAX) {
+            result = r.score > 0 ? pos.side : -pos.side;
+            break;
+        }
+        // 只保存安静局面：不被将军、最佳走法不是吃子
+        if (!in_check && pos.squares[move_to(r.best_move)] == EMPTY) {
+            records.push_back(PackedPosition());
+            pack_position(pos, r.score * pos.side, 0, records.back());
+        }
+        Undo undo;
+        pos.do_move(r.best_move, undo);
+    }
+    for (size_t i = 0; i < records.size(); i++) {
+        records[i].result = (int8_t)result;
+    }
+    return true;
+}
+
+static void generator_main(GeneratorShared* shared, int id) {
+    Engine engine;
+    engine.set_hash(8);
+    uint64_t rng = shared->seed + (uint64_t)id * 0x2545F4914F6CDD1DULL;
+    std::vector<PackedPosition> records;
+    while (shared->next_game.fetch_add(1) < shared->games) {
+        while (!play_game(shared, engine, rng, records)) {
+        }
+        // 一盘棋的记录一次写入，文件里同一盘棋的局面保持连续
+        std::lock_guard<std::mutex> lock(shared->write_mutex);
+        for (size_t i = 0; i < records.size(); i++) {
+            shared->writer.write(records[i]);
+        }
+        shared->positions += records.size();
+    }
+}
+
+// 读入所有记录，按局面哈希去重后用固定种子打乱
+static int shuffle_files(const std::vector<const char*>& inputs, const char* output, uint64_t seed) {
+    std::vector<PackedPosition> records;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        FILE* f = fopen(inputs[i], "rb");
+        if (!f) {
+            fprintf(stderr, "chess_datagen: cannot open %s\n", inputs[i]);
+            return 1;
+        }
+        PackedPosition buf[4096];
+        size_t n;
+        while ((n = fread(buf, sizeof(PackedPosition), 4096, f)) > 0) {
+            records.insert(records.end(), buf, buf + n);
+        }
+        fclose(f);
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t> > keys(records.size());
+    Position pos;
+    for (size_t i = 0; i < records.size(); i++) {
+        unpack_position(records[i], pos);
+        keys[i] = std::make_pair(pos.key, (uint32_t)i);
+    }
+    // 相同哈希只保留最先出现的一条
+    std::sort(keys.begin(), keys.end());
+    std::vector<uint32_t> order;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (i == 0 || keys[i].first != keys[i - 1].first) {
+            order.push_back(keys[i].second);
+        }
+    }
+    std::vector<std::pair<uint64_t, uint32_t> >().swap(keys);
+
+    uint64_t rng = seed;
+    for (size_t i = order.size(); i > 1; i--) {
+        std::swap(order[i - 1], order[next_random(rng) % i]);
+    }
+
+    PackedWriter* writer = new PackedWriter();
+    if (!writer->open(output, false)) {
+        fprintf(stderr, "chess_datagen: cannot write %s\n", output);
+        delete writer;
+        return 1;
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        writer->write(records[order[i]]);
+    }
+    writer->close();
+    delete writer;
+    printf("%zu records, %zu unique, wrote %s\n", records.size(), order.size(), output);
+    return 0;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: chess_datagen [-j threads] [--games N] [--nodes N] [--random-plies N] [--seed N] -o data.bin\n"
+            "       chess_datagen --shuffle [--seed N] -o out.bin in.bin...\n");
+}
+
+int main(int argc, char** argv) {
+    int threads = std::thread::hardware_concurrency();
+    int games = 1000;
+    uint64_t nodes = 5000;
+    int random_plies = 8;
+    uint64_t seed = 1;
+    bool shuffle = false;
+    const char* output = NULL;
+    std::vector<const char*> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) games = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) nodes = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--random-plies") == 0 && i + 1 < argc) random_plies = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--shuffle") == 0) shuffle = true;
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+        else if (argv[i][0] == '-') { usage(); return 1; }
+        else inputs.push_back(argv[i]);
+    }
+    if (!output || (shuffle && inputs.empty()) || (!shuffle && !inputs.empty())) {
+        usage();
+        return 1;
+    }
+    if (threads <= 0) threads = 1;
+
+    if (shuffle) {
+        return shuffle_files(inputs, output, seed);
+    }
+
+    GeneratorShared* shared = new GeneratorShared();
+    shared->output = output;
+    shared->games = games;
+    shared->nodes = nodes;
+    shared->random_plies = random_plies;
+    shared->seed = seed;
+    shared->next_game = 0;
+    shared->positions = 0;
+    if (!shared->writer.open(output)) {
+        fprintf(stderr, "chess_datagen: cannot write %s\n", output);
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(std::thread(generator_main, shared, i));
+    }
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+    shared->writer.close();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t positions = shared->positions;
+    printf("%d games, %llu positions (%llu bytes) in %.1f s, %.0f positions/s\n", games,
+           (unsigned long long)positions, (unsigned long long)(positions * sizeof(PackedPosition)), seconds,
+           seconds > 0 ? positions / seconds : 0.0);
+    delete shared;
+    return 0;
+}
@@ -0,0 +1,321 @@
+// 开局库索引工具：多线程流式解析 PGN，生成按局面哈希排序、可内存映射的开局库
+#include "bitboard.h"
+#include "opening_book.h"
+#include "pgn.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define GAMES_PER_BATCH 256
+
+typedef std::vector<PgnGame> GameBatch;
+
+// 有界队列：读取线程放入，工作线程取出，队列满时读取线程等待
+class BatchQueue {
+public:
+    explicit BatchQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+    void push(GameBatch& batch) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] { return items.size() < capacity; });
+        items.push_back(GameBatch());
+        items.back().swap(batch);
+        not_empty.notify_one();
+    }
+
+    bool pop(GameBatch& batch) {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty()) {
+            return false;
+        }
+        batch.swap(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    std::deque<GameBatch> items;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
+
+static bool entry_less(const BookEntry& a, const BookEntry& b) {
+    return a.key != b.key ? a.key < b.key : a.move < b.move;
+}
+
+static bool same_entry(const BookEntry& a, const BookEntry& b) {
+    return a.key == b.key && a.move == b.move;
+}
+
+static void add_counts(BookEntry& dst, const BookEntry& src) {
+    dst.white_wins += src.white_wins;
+    dst.draws += src.draws;
+    dst.black_wins += src.black_wins;
+}
+
+// 排序并合并相同 (key, move) 的记录
+static void sort_and_merge(std::vector<BookEntry>& records) {
+    std::sort(records.begin(), records.end(), entry_less);
+    size_t n = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        if (n > 0 && same_entry(records[n - 1], records[i])) {
+            add_counts(records[n - 1], records[i]);
+        } else {
+            records[n++] = records[i];
+        }
+    }
+    records.resize(n);
+}
+
+struct IndexerShared {
+    std::string output;
+    int max_ply;
+    size_t records_per_worker;
+    std::mutex run_mutex;
+    std::vector<std::string> runs;
+    unsigned long long games;
+    unsigned long long plies;
+};
+
+static void spill_run(IndexerShared& shared, std::vector<BookEntry>& records) {
+    sort_and_merge(records);
+    if (records.empty()) {
+        return;
+    }
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(shared.run_mutex);
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), ".run%zu.tmp", shared.runs.size());
+        name = shared.output + suffix;
+        shared.runs.push_back(name);
+    }
+    FILE* f = fopen(name.c_str(), "wb");
+    if (!f || fwrite(records.data(), sizeof(BookEntry), records.size(), f) != records.size()) {
+        fprintf(stderr, "chess_index: cannot write %s\n", name.c_str());
+        exit(1);
+    }
+    fclose(f);
+    records.clear();
+}
+
+static void worker_main(IndexerShared* shared, BatchQueue* queue) {
+    std::vector<BookEntry> records;
+    records.reserve(shared->records_per_worker);
+    std::vector<PgnPly> plies(shared->max_ply);
+    unsigned long long games = 0, total_plies = 0;
+
+    GameBatch batch;
+    while (queue->pop(batch)) {
+        for (size_t g = 0; g < batch.size(); g++) {
+            int result = batch[g].result;
+            if (result == RESULT_UNKNOWN) continue;
+
+            int n = pgn_replay(batch[g].movetext, shared->max_ply, plies.data());
+            for (int i = 0; i < n; i++) {
+                BookEntry e;
+                memset(&e, 0, sizeof(e));
+                e.key = plies[i].key;
+                e.move = plies[i].move;
+                e.white_wins = result == RESULT_WHITE_WIN;
+                e.draws = result == RESULT_DRAW;
+                e.black_wins = result == RESULT_BLACK_WIN;
+                records.push_back(e);
+            }
+            games++;
+            total_plies += n;
+
+            if (records.size() >= shared->records_per_worker) {
+                // 先就地合并，合并后仍占用过多内存才写出到临时文件
+                sort_and_merge(records);
+                if (records.size() >= shared->records_per_worker / 2) {
+                    spill_run(*shared, records);
+                }
+            }
+        }
+        batch.clear();
+    }
+    spill_run(*shared, records);
+
+    std::lock_guard<std::mutex> lock(shared->run_mutex);
+    shared->games += games;
+    shared->plies += total_plies;
+}
+
+// 顺序读取一个临时文件的缓冲读取器，用于多路归并
+class RunReader {
+public:
+    explicit RunReader(const char* path) : pos(0), len(0) {
+        file = fopen(path, "rb");
+        buffer.resize(4096);
+    }
+    ~RunReader() { if (file) fclose(file); }
+    bool next(BookEntry& e) {
+        if (pos == len) {
+            len = file ? fread(buffer.data(), sizeof(BookEntry), buffer.size(), file) : 0;
+            pos = 0;
+            if (len == 0) return false;
+        }
+        e = buffer[pos++];
+        return true;
+    }
+private:
+    FILE* file;
+    std::vector<BookEntry> buffer;
+    size_t pos, len;
+};
+
+typedef std::pair<BookEntry, size_t> HeapItem;
+
+struct HeapGreater {
+    bool operator()(const HeapItem& a, const HeapItem& b) const {
+        return entry_less(b.first, a.first);
+    }
+};
+
+static unsigned long long merge_runs(const std::vector<std::string>& runs, const char* output, uint32_t min_games) {
+    FILE* out = fopen(output, "wb");
+    if (!out) {
+        fprintf(stderr, "chess_index: cannot write %s\n", output);
+        exit(1);
+    }
+    BookHeader header;
+    memcpy(header.magic, BOOK_MAGIC, 8);
+    header.count = 0;
+    fwrite(&header, sizeof(header), 1, out);
+
+    std::vector<RunReader*> readers;
+    std::priority_queue<HeapItem, std::vector<HeapItem>, HeapGreater> heap;
+    for (size_t i = 0; i < runs.size(); i++) {
+        readers.push_back(new RunReader(runs[i].c_str()));
+        BookEntry e;
+        if (readers[i]->next(e)) heap.push(HeapItem(e, i));
+    }
+
+    bool have_current = false;
+    BookEntry current;
+    while (!heap.empty()) {
+        HeapItem top = heap.top();
+        heap.pop();
+        BookEntry e;
+        if (readers[top.second]->next(e)) heap.push(HeapItem(e, top.second));
+
+        if (have_current && same_entry(current, top.first)) {
+            add_counts(current, top.first);
+            continue;
+        }
+        if (have_current && book_games(current) >= min_games) {
+            fwrite(&current, sizeof(current), 1, out);
+            header.count++;
+        }
+        current = top.first;
+        have_current = true;
+    }
+    if (have_current && book_games(current) >= min_games) {
+        fwrite(&current, sizeof(current), 1, out);
+        header.count++;
+    }
+
+    fseek(out, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, out);
+    fclose(out);
+
+    for (size_t i = 0; i < readers.size(); i++) {
+        delete readers[i];
+        remove(runs[i].c_str());
+    }
+    return header.count;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: chess_index [-j threads] [--max-ply N] [--min-games N] [--mem MB] -o book.bin file.pgn...\n");
+}
+
+int main(int argc, char** argv) {
+    int threads = std::thread::hardware_concurrency();
+    int max_ply = 30;
+    uint32_t min_games = 1;
+    size_t mem_mb = 512;
+    const char* output = NULL;
+    std::vector<const char*> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-ply") == 0 && i + 1 < argc) max_ply = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--min-games") == 0 && i + 1 < argc) min_games = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--mem") == 0 && i + 1 < argc) mem_mb = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+        else if (argv[i][0] == '-') { usage(); return 1; }
+        else inputs.push_back(argv[i]);
+    }
+    if (!output || inputs.empty() || max_ply <= 0) {
+        usage();
+        return 1;
+    }
+    if (threads <= 0) threads = 1;
+
+
+    IndexerShared shared;
+    shared.output = output;
+    shared.max_ply = max_ply;
+    shared.records_per_worker = std::max<size_t>(mem_mb * 1024 * 1024 / sizeof(BookEntry) / threads, 1024);
+    shared.games = 0;
+    shared.plies = 0;
+
+    BatchQueue queue(threads * 2);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(std::thread(worker_main, &shared, &queue));
+    }
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        PgnReader reader;
+        if (!reader.open(inputs[i])) {
+            fprintf(stderr, "chess_index: cannot open %s\n", inputs[i]);
+            continue;
+        }
+        GameBatch batch;
+        PgnGame game;
+        while (reader.next_game(game)) {
+            batch.push_back(PgnGame());
+            batch.back().result = game.result;
+            batch.back().movetext.swap(game.movetext);
+            if (batch.size() == GAMES_PER_BATCH) {
+                queue.push(batch);
+            }
+        }
+        if (!batch.empty()) {
+            queue.push(batch);
+        }
+    }
+    queue.close();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+
+    unsigned long long entries = merge_runs(shared.runs, output, min_games);
+    printf("games: %llu  plies: %llu  entries: %llu  runs: %zu\n",
+           shared.games, shared.plies, entries, shared.runs.size());
+    return 0;
+}
@@ -0,0 +1,119 @@
+// 将杀求解工具：对每个 FEN / EPD 局面用 df-pn 证明或否定轮到走棋的一方存在强制将杀，
+// 输出几步杀和主变例；--compare 时再用 alpha-beta 搜索同一局面，比较节点数和用时
+#include "mate_search.h"
+#include "search.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void print_pv(const MoveCode* pv, int length) {
+    for (int i = 0; i < length; i++) {
+        char buf[8];
+        move_to_string(pv[i], buf);
+        printf(" %s", buf);
+    }
+}
+
+// 用 alpha-beta 逐层加深直到分数显示出杀，作为对照
+static void compare_alpha_beta(const Position& pos, int max_moves, uint64_t nodes) {
+    Engine engine;
+    SearchLimits limits;
+    memset(&limits, 0, sizeof(limits));
+    limits.depth = 2 * max_moves - 1 < MAX_PLY - 1 ? 2 * max_moves - 1 : MAX_PLY - 1;
+    limits.nodes = nodes;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SearchResult result = engine.search(pos, limits);
+    double ms = elapsed_ms(start);
+    printf("  alpha-beta: ");
+    if (result.score >= SCORE_MATE_IN_MAX) {
+        printf("mate in %d", (SCORE_MATE - result.score + 1) / 2);
+    } else {
+        printf("no mate found (score %d, depth %d)", result.score, result.depth);
+    }
+    printf(", %llu nodes, %.1f ms\n", (unsigned long long)engine.last_stats().nodes, ms);
+}
+
+static void usage() {
+    fprintf(stderr, "usage: chess_mate [--moves N] [--nodes N] [--hash MB] [--checks] [--compare] [FEN | -f file.epd]\n");
+}
+
+int main(int argc, char** argv) {
+    MateLimits limits;
+    memset(&limits, 0, sizeof(limits));
+    limits.max_moves = 10;
+    size_t hash_mb = 64;
+    bool compare = false;
+    const char* file = NULL;
+    std::vector<std::string> fens;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--moves") == 0 && i + 1 < argc) limits.max_moves = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) limits.nodes = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) hash_mb = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--checks") == 0) limits.checks_only = true;
+        else if (strcmp(argv[i], "--compare") == 0) compare = true;
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) file = argv[++i];
+        else if (argv[i][0] == '-') { usage(); return 1; }
+        else fens.push_back(argv[i]);
+    }
+
+    // 没有给出局面时从文件或标准输入逐行读取，空行和 # 开头的行跳过
+    if (fens.empty()) {
+        FILE* in = file ? fopen(file, "r") : stdin;
+        if (!in) {
+            fprintf(stderr, "chess_mate: cannot open %s\n", file);
+            return 1;
+        }
+        char line[512];
+        while (fgets(line, sizeof(line), in)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] != '\0' && line[0] != '#') {
+                fens.push_back(line);
+            }
+        }
+        if (in != stdin) {
+            fclose(in);
+        }
+    }
+    if (limits.max_moves <= 0 || limits.max_moves > MATE_MAX_MOVES) {
+        limits.max_moves = MATE_MAX_MOVES;
+    }
+
+    MateSolver solver;
+    solver.set_hash(hash_mb);
+    int proven = 0;
+    for (size_t i = 0; i < fens.size(); i++) {
+        Position pos;
+        if (!pos.set_fen(fens[i].c_str())) {
+            fprintf(stderr, "chess_mate: bad FEN: %s\n", fens[i].c_str());
+            continue;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        MateResult result = solver.solve(pos, limits);
+        double ms = elapsed_ms(start);
+
+        printf("%s\n  df-pn: ", fens[i].c_str());
+        if (result.status == MATE_PROVEN) {
+            printf("mate in %s%d:", result.shortest ? "" : "<= ", result.moves);
+            print_pv(result.pv, result.pv_length);
+            proven++;
+        } else if (result.status == MATE_DISPROVEN) {
+            printf("no mate in %d", limits.max_moves);
+        } else {
+            printf("unknown (node budget exhausted)");
+        }
+        printf(", %llu nodes, %.1f ms\n", (unsigned long long)result.nodes, ms);
+        if (compare) {
+            compare_alpha_beta(pos, result.status == MATE_PROVEN ? result.moves : limits.max_moves, limits.nodes);
+        }
+    }
+    printf("%d/%zu positions mated\n", proven, fens.size());
+    return 0;
+}
@@ -0,0 +1,38 @@
+// 无界面引擎服务：在 Unix 套接字上同时服务多局对局，协议见 include/server.h 和 README
+#include "server.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static void usage() {
+    fprintf(stderr, "usage: chess_server [--socket PATH] [--workers N] [--queue N] [--sessions N] [--hash MB] [--nodes N]\n");
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    options.socket_path = "/tmp/chess.sock";
+    options.workers = (int)std::thread::hardware_concurrency();
+    if (options.workers < 1) {
+        options.workers = 1;
+    }
+    options.queue_size = 1024;
+    options.max_sessions = 4096;
+    options.hash_mb = 16;
+    options.default_nodes = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) options.socket_path = argv[++i];
+        else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) options.workers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--queue") == 0 && i + 1 < argc) options.queue_size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) options.max_sessions = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) options.hash_mb = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) options.default_nodes = strtoull(argv[++i], NULL, 10);
+        else { usage(); return 1; }
+    }
+    if (options.workers < 1 || options.queue_size < 1) {
+        usage();
+        return 1;
+    }
+    return run_server(options);
+}
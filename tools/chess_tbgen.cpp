@@ -0,0 +1,421 @@
+// 残局库生成工具：按本项目规则（无升变、无易位和吃过路兵）对不超过 5 个棋子的残局做逆向分析，
+// 每种子力组合写出 .dtm（距将杀半步数）和 .wdl（胜负和）两个游程编码文件，引擎运行时 mmap 查询。
+// 吃子后的局面查已经生成的更小的表，所以按棋子数从少到多生成；输出目录中已有的表直接加载
+#include "tablebase.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#define UNKNOWN        255   // 生成过程中尚未确定
+#define NO_LOSS        128   // 有吃子可以逼和：剩余走法计数加上它，永远不会减到 0
+#define CHUNK          65536 // 线程每次领取的局面数
+
+// 每个局面 3 个字节：距将杀半步数、尚未确定为对方胜的不吃子走法数、吃子后最长的输棋距离
+#define BYTES_PER_POSITION 3
+
+// 生成结束后直接把原子数组当作字节数组写出
+static_assert(sizeof(std::atomic<uint8_t>) == 1, "std::atomic<uint8_t> must be one byte");
+
+typedef struct {
+    TbLayout layout;
+    std::atomic<uint8_t>* dtm;
+    std::atomic<uint8_t>* remaining;
+    uint8_t* capture_loss;
+    std::atomic<int> max_value;      // 已经给出的最大半步数，逐层推进到它为止
+    std::atomic<bool> missing;       // 吃子后的表不存在
+    std::atomic<bool> overflow;      // 距将杀超过 TB_MAX_PLIES
+} Generation;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 把 [0, size) 切成小块分给各线程
+template <typename F>
+static void parallel_for(uint64_t size, int threads, F body) {
+    std::atomic<uint64_t> next(0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&]() {
+            Position pos;
+            while (true) {
+                uint64_t begin = next.fetch_add(CHUNK);
+                if (begin >= size) {
+                    break;
+                }
+                uint64_t end = std::min(begin + CHUNK, size);
+                for (uint64_t i = begin; i < end; i++) {
+                    body(i, pos);
+                }
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+}
+
+static void raise_max(std::atomic<int>& max_value, int value) {
+    int current = max_value.load();
+    while (value > current && !max_value.compare_exchange_weak(current, value)) {
+    }
+}
+
+static int unique_indices(uint64_t* list, int n) {
+    std::sort(list, list + n);
+    return (int)(std::unique(list, list + n) - list);
+}
+
+// 正向扫描一次：杀、逼和直接定出；吃子查更小的表，取得胜的最短距离和输棋的最长距离；
+// 不吃子的走法只计数，留给逆向扩展
+static void initialize(Generation& g, uint64_t i, Position& pos) {
+    if (!tb_decode(g.layout, i, pos) || pos.in_check(-pos.side)) {
+        g.dtm[i].store(TB_ILLEGAL, std::memory_order_relaxed);
+        return;
+    }
+    MoveCode moves[MAX_MOVES];
+    int count = generate_legal_moves(pos, moves);
+    if (count == 0) {
+        g.dtm[i].store(pos.in_check(pos.side) ? 0 : TB_DRAW, std::memory_order_relaxed);
+        g.remaining[i].store(0, std::memory_order_relaxed);
+        return;
+    }
+
+    uint64_t successors[MAX_MOVES];
+    int quiet = 0;
+    int win = UNKNOWN, loss = 0;
+    bool draw = false;
+    for (int m = 0; m < count; m++) {
+        bool capture = pos.squares[move_to(moves[m])] != EMPTY;
+        Undo undo;
+        pos.do_move(moves[m], undo);
+        if (!capture) {
+            successors[quiet++] = tb_index(g.layout, pos);
+        } else {
+            int wdl, plies;
+            if (!tb_probe_dtm(pos, wdl, plies)) {
+                g.missing.store(true);
+            } else if (wdl == TB_DRAW_WDL) {
+                draw = true;
+            } else if (wdl == TB_LOSS) {
+                win = std::min(win, plies + 1);
+            } else {
+                loss = std::max(loss, plies + 1);
+            }
+        }
+        pos.undo_move(undo);
+    }
+
+    int remaining = unique_indices(successors, quiet) + (draw ? NO_LOSS : 0);
+    uint8_t value = UNKNOWN;
+    if (win != UNKNOWN) {
+        value = (uint8_t)win;
+    } else if (remaining == 0) {
+        // 只有吃子可走，而且每个吃子都输
+        value = (uint8_t)loss;
+    }
+    if (value != UNKNOWN) {
+        if (value > TB_MAX_PLIES) {
+            g.overflow.store(true);
+            value = TB_MAX_PLIES - (value & 1 ? 1 : 0);
+        }
+        raise_max(g.max_value, value);
+    }
+    g.dtm[i].store(value, std::memory_order_relaxed);
+    g.remaining[i].store((uint8_t)remaining, std::memory_order_relaxed);
+    g.capture_loss[i] = (uint8_t)std::min(loss, TB_MAX_PLIES);
+}
+
+// 刚走完一步的一方在 to 上的棋子退回去的所有格子（只退不吃子的走法）
+static Bitboard retreat_squares(const Position& pos, int to) {
+    Bitboard empty = ~pos.occupied();
+    int piece = pos.squares[to];
+    switch (abs(piece)) {
+        case PAWN: {
+            // 白兵向上走，从下一行退回，双步只能从起始行出发；兵不会从己方底线出发。黑兵相反
+            int back = piece > 0 ? 8 : -8;
+            int start_row = piece > 0 ? 6 : 1;
+            int one = to + back;
+            Bitboard result = 0;
+            if (SQ_Y(one) != (piece > 0 ? 7 : 0) && (empty & BIT(one))) {
+                result |= BIT(one);
+                int two = one + back;
+                if (SQ_Y(one) != start_row && SQ_Y(two) == start_row && (empty & BIT(two))) {
+                    result |= BIT(two);
+                }
+            }
+            return result;
+        }
+        case KNIGHT: return knight_attacks[to] & empty;
+        case BISHOP: return bishop_attacks(to, pos.occupied()) & empty;
+        case ROOK:   return rook_attacks(to, pos.occupied()) & empty;
+        case QUEEN:  return (bishop_attacks(to, pos.occupied()) | rook_attacks(to, pos.occupied())) & empty;
+        case KING:   return king_attacks[to] & empty;
+    }
+    return 0;
+}
+
+// 第 n 层：轮到走棋的一方 n 半步后被杀（n 为偶数）时，所有前驱局面都在 n + 1 半步内取胜；
+// 轮到走棋的一方取胜（n 为奇数）时，前驱局面少一个逃路，逃路用完就在 n + 1 半步（或吃子输得更慢时更久）后被杀
+static void retrograde(Generation& g, uint64_t i, int n, Position& pos) {
+    if (g.dtm[i].load(std::memory_order_relaxed) != n) {
+        return;
+    }
+    tb_decode(g.layout, i, pos);
+    int mover = -pos.side;
+    uint64_t predecessors[MAX_MOVES * 2];
+    int count = 0;
+    Bitboard pieces = pos.by_color[color_index(mover)];
+    while (pieces) {
+        int to = pop_lsb(pieces);
+        int piece = pos.squares[to];
+        Bitboard from = retreat_squares(pos, to);
+        while (from) {
+            int sq = pop_lsb(from);
+            pos.remove_piece(to);
+            pos.put_piece(sq, piece);
+            pos.side = mover;
+            predecessors[count++] = tb_index(g.layout, pos);
+            pos.remove_piece(sq);
+            pos.put_piece(to, piece);
+            pos.side = -mover;
+        }
+    }
+    count = unique_indices(predecessors, count);
+
+    for (int k = 0; k < count; k++) {
+        uint64_t q = predecessors[k];
+        uint8_t value = g.dtm[q].load(std::memory_order_relaxed);
+        if (value == TB_ILLEGAL) {
+            continue;
+        }
+        if (n % 2 == 0) {
+            // 取胜：未定局面，或者吃子得出的更慢的胜法
+            while ((value == UNKNOWN || (value < TB_DRAW && (value & 1) && value > n + 1))
+                   && !g.dtm[q].compare_exchange_weak(value, (uint8_t)(n + 1))) {
+            }
+            raise_max(g.max_value, n + 1);
+        } else if (g.remaining[q].fetch_sub(1) == 1) {
+            int loss = std::max(n + 1, (int)g.capture_loss[q]);
+            if (loss > TB_MAX_PLIES) {
+                g.overflow.store(true);
+                loss = TB_MAX_PLIES;
+            }
+            uint8_t expected = UNKNOWN;
+            if (g.dtm[q].compare_exchange_strong(expected, (uint8_t)loss)) {
+                raise_max(g.max_value, loss);
+            }
+        }
+    }
+}
+
+typedef struct {
+    int threads;
+    size_t memory_mb;
+    std::string dir;
+    bool verbose;
+} Options;
+
+static bool file_exists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+static long peak_rss_mb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;
+}
+
+static bool generate(const char* name, const Options& opt, std::vector<std::string>& failed);
+
+// 先保证所有吃掉一个子以后的表都已存在
+static bool ensure(const char* name, const Options& opt, std::vector<std::string>& failed) {
+    if (std::find(failed.begin(), failed.end(), name) != failed.end()) {
+        return false;
+    }
+    std::string base = opt.dir + "/" + name;
+    if (file_exists(base + ".dtm")) {
+        tb_load((base + ".wdl").c_str());
+        return tb_load((base + ".dtm").c_str()) > 0;
+    }
+    TbLayout layout;
+    tb_layout(name, layout);
+    for (int i = 2; i < layout.count; i++) {
+        if (i > 2 && layout.pieces[i] == layout.pieces[i - 1]) {
+            continue;
+        }
+        std::string white = "K", black = "K";
+        for (int j = 2; j < layout.count; j++) {
+            if (j == i) continue;
+            std::string& side = layout.pieces[j] > 0 ? white : black;
+            side += "QRBNP"[QUEEN - abs(layout.pieces[j])];
+        }
+        if (white == "K" && black == "K") {
+            continue;
+        }
+        char sub[TB_NAME_SIZE];
+        tb_canonical_name((white + "v" + black).c_str(), sub);
+        if (!ensure(sub, opt, failed)) {
+            fprintf(stderr, "%s: skipped, %s is not available\n", name, sub);
+            failed.push_back(name);
+            return false;
+        }
+    }
+    return generate(name, opt, failed);
+}
+
+static bool generate(const char* name, const Options& opt, std::vector<std::string>& failed) {
+    Generation g;
+    tb_layout(name, g.layout);
+    uint64_t size = g.layout.size;
+    size_t needed_mb = (size_t)((size * BYTES_PER_POSITION) >> 20) + 1;
+    if (needed_mb > opt.memory_mb) {
+        fprintf(stderr, "%s: needs %zu MB (%llu positions), over the --memory limit of %zu MB\n",
+                name, needed_mb, (unsigned long long)size, opt.memory_mb);
+        failed.push_back(name);
+        return false;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    g.dtm = new std::atomic<uint8_t>[size];
+    g.remaining = new std::atomic<uint8_t>[size];
+    g.capture_loss = new uint8_t[size];
+    g.max_value.store(0);
+    g.missing.store(false);
+    g.overflow.store(false);
+
+    parallel_for(size, opt.threads, [&](uint64_t i, Position& pos) { initialize(g, i, pos); });
+    int levels = 0;
+    for (int n = 0; n <= g.max_value.load() && n <= TB_MAX_PLIES; n++) {
+        parallel_for(size, opt.threads, [&](uint64_t i, Position& pos) { retrograde(g, i, n, pos); });
+        levels++;
+    }
+
+    // 没有定出胜负的局面都是和棋：弱的一方可以一直避开被杀
+    uint8_t* values = (uint8_t*)g.remaining;
+    uint64_t counts[3] = {0, 0, 0};
+    int longest = 0;
+    for (uint64_t i = 0; i < size; i++) {
+        uint8_t v = g.dtm[i].load(std::memory_order_relaxed);
+        if (v == UNKNOWN) {
+            v = TB_DRAW;
+            g.dtm[i].store(v, std::memory_order_relaxed);
+        }
+        int wdl = v == TB_ILLEGAL ? TB_ILLEGAL : v == TB_DRAW ? TB_DRAW_WDL : (v & 1) ? TB_WIN : TB_LOSS;
+        values[i] = (uint8_t)wdl;
+        if (wdl != TB_ILLEGAL) {
+            counts[wdl]++;
+            if (wdl != TB_DRAW_WDL) longest = std::max(longest, (int)v);
+        }
+    }
+    delete[] g.capture_loss;
+
+    std::string base = opt.dir + "/" + name;
+    bool ok = !g.missing.load()
+           && tb_write((base + ".wdl").c_str(), g.layout, TB_KIND_WDL, values)
+           && tb_write((base + ".dtm").c_str(), g.layout, TB_KIND_DTM, (const uint8_t*)g.dtm);
+    delete[] g.dtm;
+    delete[] g.remaining;
+    if (!ok) {
+        fprintf(stderr, "%s: %s\n", name, g.missing.load() ? "a capture leads to a missing table" : "write failed");
+        failed.push_back(name);
+        return false;
+    }
+    tb_load((base + ".dtm").c_str());
+    tb_load((base + ".wdl").c_str());
+
+    struct stat dtm_st, wdl_st;
+    stat((base + ".dtm").c_str(), &dtm_st);
+    stat((base + ".wdl").c_str(), &wdl_st);
+    uint64_t legal = counts[0] + counts[1] + counts[2];
+    printf("%-8s %10llu legal  win %5.1f%%  draw %5.1f%%  loss %5.1f%%  longest mate %3d plies  "
+           "dtm %7.1f KB  wdl %7.1f KB  %3d levels  %.0f ms%s\n",
+           name, (unsigned long long)legal,
+           100.0 * counts[TB_WIN] / legal, 100.0 * counts[TB_DRAW_WDL] / legal, 100.0 * counts[TB_LOSS] / legal,
+           longest, dtm_st.st_size / 1024.0, wdl_st.st_size / 1024.0, levels, elapsed_ms(start),
+           g.overflow.load() ? "  (mate distance capped)" : "");
+    fflush(stdout);
+    return true;
+}
+
+// 一方除王以外的所有子力组合，棋子从大到小排列
+static void side_combinations(int pieces, int min_type, std::string prefix, std::vector<std::string>& out) {
+    out.push_back(prefix);
+    if (pieces == 0) {
+        return;
+    }
+    for (int type = min_type; type >= PAWN; type--) {
+        side_combinations(pieces - 1, type, prefix + "QRBNP"[QUEEN - type], out);
+    }
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: chess_tbgen [-j threads] [--pieces N] [--memory MB] [-o dir] [NAME...]\n"
+            "  NAME like KQvKR; without names every table with up to N pieces (default 4) is generated\n");
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    opt.threads = std::thread::hardware_concurrency();
+    opt.memory_mb = 1024;
+    opt.dir = "tablebases";
+    int max_pieces = 4;
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) opt.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--pieces") == 0 && i + 1 < argc) max_pieces = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) opt.memory_mb = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) opt.dir = argv[++i];
+        else if (argv[i][0] == '-') { usage(); return 1; }
+        else names.push_back(argv[i]);
+    }
+    if (opt.threads <= 0) opt.threads = 1;
+    if (max_pieces < 3 || max_pieces > TB_MAX_PIECES) {
+        fprintf(stderr, "chess_tbgen: --pieces must be between 3 and %d\n", TB_MAX_PIECES);
+        return 1;
+    }
+    mkdir(opt.dir.c_str(), 0755);
+
+    if (names.empty()) {
+        // 按棋子数从少到多，同一组合只保留强的一方在前的写法
+        std::vector<std::string> sides;
+        side_combinations(max_pieces - 2, QUEEN, "K", sides);
+        for (int n = 3; n <= max_pieces; n++) {
+            for (size_t a = 0; a < sides.size(); a++) {
+                for (size_t b = 0; b < sides.size(); b++) {
+                    std::string name = sides[a] + "v" + sides[b];
+                    char canonical[TB_NAME_SIZE];
+                    if ((int)(sides[a].size() + sides[b].size()) == n && tb_canonical_name(name.c_str(), canonical)
+                        && name == canonical) {
+                        names.push_back(name);
+                    }
+                }
+            }
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::string> failed;
+    int done = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        char canonical[TB_NAME_SIZE];
+        if (!tb_canonical_name(names[i].c_str(), canonical)) {
+            fprintf(stderr, "chess_tbgen: bad table name %s\n", names[i].c_str());
+            return 1;
+        }
+        done += ensure(canonical, opt, failed) ? 1 : 0;
+    }
+    printf("%d tables in %s, %zu skipped, %.1f s, peak memory %ld MB\n",
+           done, opt.dir.c_str(), failed.size(), elapsed_ms(start) / 1000, peak_rss_mb());
+    return failed.empty() ? 0 : 2;
+}
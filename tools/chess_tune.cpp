@@ -0,0 +1,372 @@
+// Texel 调参工具：读取带对局结果的局面，用静态搜索找到安静局面后，
+// 多线程做梯度下降，调整子力价值和位置表，输出生成的头文件
+#include "bitboard.h"
+#include "evaluate.h"
+#include "packed_position.h"
+#include "piece.h"
+#include "search.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 参数布局：5 个子力价值（兵到后），然后 6 张位置表（兵到王），
+// 位置表按 piece_square.h 中的黑方视角存放
+#define PARAM_MATERIAL 0
+#define PARAM_PST      5
+#define PARAM_COUNT    (PARAM_PST + 6 * 64)
+
+#define QS_MAX_PLY 16
+
+typedef struct {
+    PackedPosition leaf;   // 静态搜索主变例末端的安静局面
+    float result;          // 白方得分：1、0.5、0
+    int fixed;             // 不参与调参的评估项（兵形分），白方视角
+} Sample;
+
+static int pst_index(int piece, int sq) {
+    int y = SQ_Y(sq), x = SQ_X(sq);
+    int table_r = piece > 0 ? 7 - y : y;
+    return PARAM_PST + (abs(piece) - 1) * 64 + table_r * 8 + x;
+}
+
+// 在当前评估下做只吃子的静态搜索，leaf 为主变例末端的局面
+static int quiesce(Position& pos, int alpha, int beta, int ply, Position& leaf) {
+    int best = evaluate(pos);
+    leaf = pos;
+    if (best >= beta || ply >= QS_MAX_PLY) {
+        return best;
+    }
+    if (best > alpha) {
+        alpha = best;
+    }
+
+    MoveCode moves[MAX_MOVES];
+    int count = generate_captures(pos, moves);
+    // 先吃价值高的子
+    std::sort(moves, moves + count, [&pos](MoveCode a, MoveCode b) {
+        return get_piece_value(pos.squares[move_to(a)]) > get_piece_value(pos.squares[move_to(b)]);
+    });
+    int mover = pos.side;
+    Position child_leaf;
+    for (int i = 0; i < count; i++) {
+        Undo undo;
+        pos.do_move(moves[i], undo);
+        if (pos.in_check(mover)) {
+            pos.undo_move(undo);
+            continue;
+        }
+        int score = -quiesce(pos, -beta, -alpha, ply + 1, child_leaf);
+        pos.undo_move(undo);
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                leaf = child_leaf;
+                if (alpha >= beta) {
+                    break;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+// 把局面换成静态搜索的末端局面；被将军的局面不适合调参，返回 false
+static bool make_sample(Position& pos, int result, Sample& sample) {
+    if (pos.in_check(pos.side)) {
+        return false;
+    }
+    Position leaf;
+    quiesce(pos, -SCORE_INF, SCORE_INF, 0, leaf);
+    if (leaf.in_check(leaf.side)) {
+        return false;
+    }
+    pack_position(leaf, 0, result, sample.leaf);
+    sample.result = (result + 1) * 0.5f;
+    sample.fixed = evaluate_pawns(leaf);
+    return true;
+}
+
+// 把 [0, n) 平均分给 threads 个线程，f(begin, end, thread_id)
+template <typename F>
+static void parallel_for(int threads, size_t n, F f) {
+    std::vector<std::thread> pool;
+    size_t chunk = (n + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        size_t begin = std::min(n, chunk * t), end = std::min(n, chunk * (t + 1));
+        pool.push_back(std::thread(f, begin, end, t));
+    }
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i].join();
+    }
+}
+
+static bool load_packed(const char* path, size_t limit, std::vector<PackedPosition>& raw) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    PackedPosition buf[4096];
+    size_t n;
+    while (raw.size() < limit && (n = fread(buf, sizeof(PackedPosition), 4096, f)) > 0) {
+        raw.insert(raw.end(), buf, buf + std::min(n, limit - raw.size()));
+    }
+    fclose(f);
+    return true;
+}
+
+// EPD/FEN 文本，每行一个局面，结果写成 "1-0"、"0-1"、"1/2-1/2" 或 [1.0]、[0.5]、[0.0]
+static bool load_epd(const char* path, size_t limit, std::vector<PackedPosition>& raw) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char line[512];
+    Position pos;
+    while (raw.size() < limit && fgets(line, sizeof(line), f)) {
+        // 结果只在棋子布局之后查找
+        const char* rest = strchr(line, ' ');
+        int result;
+        if (!rest) continue;
+        if (strstr(rest, "1/2-1/2") || strstr(rest, "[0.5]")) result = 0;
+        else if (strstr(rest, "1-0") || strstr(rest, "[1.0]")) result = 1;
+        else if (strstr(rest, "0-1") || strstr(rest, "[0.0]")) result = -1;
+        else continue;
+        if (!pos.set_fen(line)) {
+            continue;
+        }
+        raw.push_back(PackedPosition());
+        pack_position(pos, 0, result, raw.back());
+    }
+    fclose(f);
+    return true;
+}
+
+class Tuner {
+public:
+    Tuner(std::vector<Sample>& samples, int threads) : samples(samples), threads(threads), partial(threads) {
+        params.assign(PARAM_COUNT, 0.0);
+        for (int type = PAWN; type < KING; type++) {
+            params[PARAM_MATERIAL + type - 1] = get_piece_value(type) * 10;
+        }
+        // get_positional_score 对黑方棋子直接按表格行列读取
+        for (int type = PAWN; type <= KING; type++) {
+            for (int sq = 0; sq < 64; sq++) {
+                params[PARAM_PST + (type - 1) * 64 + sq] = get_positional_score(-type, SQ_Y(sq), SQ_X(sq));
+            }
+        }
+    }
+
+    // 均方误差；grad 不为空时同时累加梯度
+    double loss(double k, std::vector<double>* grad) {
+        parallel_for(threads, samples.size(), [this, k, grad](size_t begin, size_t end, int t) {
+            Partial& part = partial[t];
+            part.loss = 0;
+            if (grad) {
+                part.grad.assign(PARAM_COUNT, 0.0);
+            }
+            int feature[64], coef[64];
+            for (size_t i = begin; i < end; i++) {
+                const Sample& s = samples[i];
+                int n = 0;
+                Bitboard occ = s.leaf.occupancy;
+                for (int index = 0; occ; index++) {
+                    int sq = pop_lsb(occ);
+                    int piece = packed_piece(s.leaf, index);
+                    int sign = piece > 0 ? 1 : -1;
+                    if (abs(piece) != KING) {
+                        feature[n] = PARAM_MATERIAL + abs(piece) - 1;
+                        coef[n++] = sign;
+                    }
+                    feature[n] = pst_index(piece, sq);
+                    coef[n++] = sign;
+                }
+                double eval = s.fixed;
+                for (int j = 0; j < n; j++) {
+                    eval += params[feature[j]] * coef[j];
+                }
+                double sigmoid = 1.0 / (1.0 + exp(-k * eval));
+                double err = sigmoid - s.result;
+                part.loss += err * err;
+                if (grad) {
+                    double g = err * sigmoid * (1.0 - sigmoid);
+                    for (int j = 0; j < n; j++) {
+                        part.grad[feature[j]] += g * coef[j];
+                    }
+                }
+            }
+        });
+        double total = 0;
+        if (grad) {
+            grad->assign(PARAM_COUNT, 0.0);
+        }
+        for (int t = 0; t < threads; t++) {
+            total += partial[t].loss;
+            if (grad) {
+                for (int j = 0; j < PARAM_COUNT; j++) {
+                    (*grad)[j] += partial[t].grad[j];
+                }
+            }
+        }
+        return total / samples.size();
+    }
+
+    // 在对数刻度上三分搜索使误差最小的缩放系数 K
+    double fit_k() {
+        double lo = log(1e-4), hi = log(5e-2);
+        for (int i = 0; i < 40; i++) {
+            double a = lo + (hi - lo) / 3, b = hi - (hi - lo) / 3;
+            if (loss(exp(a), NULL) < loss(exp(b), NULL)) hi = b;
+            else lo = a;
+        }
+        return exp((lo + hi) / 2);
+    }
+
+    // Adam 梯度下降，步长以评估单位计
+    void run(double k, int epochs, double rate) {
+        std::vector<double> grad, m(PARAM_COUNT, 0.0), v(PARAM_COUNT, 0.0);
+        const double beta1 = 0.9, beta2 = 0.999;
+        double scale = 2.0 * k / samples.size();
+        for (int epoch = 1; epoch <= epochs; epoch++) {
+            double l = loss(k, &grad);
+            for (int j = 0; j < PARAM_COUNT; j++) {
+                double g = grad[j] * scale;
+                m[j] = beta1 * m[j] + (1 - beta1) * g;
+                v[j] = beta2 * v[j] + (1 - beta2) * g * g;
+                double mh = m[j] / (1 - pow(beta1, epoch));
+                double vh = v[j] / (1 - pow(beta2, epoch));
+                params[j] -= rate * mh / (sqrt(vh) + 1e-12);
+            }
+            if (epoch % 10 == 0 || epoch == epochs) {
+                printf("epoch %5d  loss %.6f\n", epoch, l);
+                fflush(stdout);
+            }
+        }
+    }
+
+    std::vector<double> params;
+
+private:
+    struct Partial {
+        double loss;
+        std::vector<double> grad;
+    };
+    std::vector<Sample>& samples;
+    int threads;
+    std::vector<Partial> partial;
+};
+
+static const char* table_names[6] = {"pawn", "knight", "bishop", "rook", "queen", "king"};
+
+static bool write_header(const char* path, const std::vector<double>& params, size_t count, double k,
+                         double before, double after) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        return false;
+    }
+    fprintf(f, "// 由 chess_tune 生成，请勿手工修改\n");
+    fprintf(f, "// 局面数 %zu，K = %.6f，误差 %.6f -> %.6f\n", count, k, before, after);
+    fprintf(f, "#pragma once\n\n");
+    fprintf(f, "// 子力价值，evaluate 的单位（兵 = 100），下标为棋子类型\n");
+    fprintf(f, "static const int tuned_piece_values[7] = {0");
+    for (int type = PAWN; type < KING; type++) {
+        fprintf(f, ", %d", (int)lround(params[PARAM_MATERIAL + type - 1]));
+    }
+    fprintf(f, ", 0};\n");
+    // 与 piece_square.h 相同，按黑方视角存放
+    for (int type = PAWN; type <= KING; type++) {
+        fprintf(f, "\nstatic const int tuned_%s_table[8][8] = {\n", table_names[type - 1]);
+        for (int r = 0; r < 8; r++) {
+            fprintf(f, "    {");
+            for (int c = 0; c < 8; c++) {
+                fprintf(f, "%4d%s", (int)lround(params[PARAM_PST + (type - 1) * 64 + r * 8 + c]), c < 7 ? "," : "");
+            }
+            fprintf(f, "}%s\n", r < 7 ? "," : "");
+        }
+        fprintf(f, "};\n");
+    }
+    fclose(f);
+    return true;
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: chess_tune [-j threads] [--epochs N] [--rate R] [--limit N] [-o tuned_tables.h] data.bin|data.epd\n");
+}
+
+int main(int argc, char** argv) {
+    int threads = std::thread::hardware_concurrency();
+    int epochs = 1000;
+    double rate = 0.5;
+    size_t limit = (size_t)-1;
+    const char* output = "tuned_tables.h";
+    const char* input = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--epochs") == 0 && i + 1 < argc) epochs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) rate = atof(argv[++i]);
+        else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) limit = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+        else if (argv[i][0] == '-') { usage(); return 1; }
+        else input = argv[i];
+    }
+    if (!input || epochs <= 0) {
+        usage();
+        return 1;
+    }
+    if (threads <= 0) threads = 1;
+
+    std::vector<PackedPosition> raw;
+    std::string name = input;
+    bool text = name.size() > 4 && (name.compare(name.size() - 4, 4, ".epd") == 0
+                                    || name.compare(name.size() - 4, 4, ".fen") == 0);
+    if (!(text ? load_epd(input, limit, raw) : load_packed(input, limit, raw))) {
+        fprintf(stderr, "chess_tune: cannot open %s\n", input);
+        return 1;
+    }
+
+    // 各线程分别把局面换成安静局面，再按原顺序拼接
+    std::vector<std::vector<Sample> > parts(threads);
+    parallel_for(threads, raw.size(), [&raw, &parts](size_t begin, size_t end, int t) {
+        Position pos;
+        Sample sample;
+        for (size_t i = begin; i < end; i++) {
+            unpack_position(raw[i], pos);
+            if (make_sample(pos, raw[i].result, sample)) {
+                parts[t].push_back(sample);
+            }
+        }
+    });
+    std::vector<Sample> samples;
+    for (int t = 0; t < threads; t++) {
+        samples.insert(samples.end(), parts[t].begin(), parts[t].end());
+        std::vector<Sample>().swap(parts[t]);
+    }
+    std::vector<PackedPosition>().swap(raw);
+    if (samples.empty()) {
+        fprintf(stderr, "chess_tune: no usable positions in %s\n", input);
+        return 1;
+    }
+    printf("%zu quiet positions, %d threads\n", samples.size(), threads);
+
+    Tuner tuner(samples, threads);
+    double k = tuner.fit_k();
+    double before = tuner.loss(k, NULL);
+    printf("K = %.6f, initial loss %.6f\n", k, before);
+    tuner.run(k, epochs, rate);
+    double after = tuner.loss(k, NULL);
+
+    if (!write_header(output, tuner.params, samples.size(), k, before, after)) {
+        fprintf(stderr, "chess_tune: cannot write %s\n", output);
+        return 1;
+    }
+    printf("loss %.6f -> %.6f, wrote %s\n", before, after, output);
+    return 0;
+}